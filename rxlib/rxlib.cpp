@@ -1,5 +1,6 @@
 // Copyright 2020 cryptonote.social. All rights reserved. Use of this source code is governed by
 // the license found in the LICENSE file.
+#include <algorithm>
 #include <atomic>
 #include <cfenv>
 #include <string>
@@ -20,6 +21,43 @@ static std::vector<randomx_vm*> vm;
 
 static std::atomic<uint32_t> atomic_nonce(1);
 
+static randomx_tuning tuning;
+static bool have_tuning = false;
+
+// Loads the profile written by "randomx-benchmark --autotune" for this host, if any.
+static void load_tuning() {
+  static bool loaded = false;
+  if (loaded) return;
+  loaded = true;
+  have_tuning = randomx_load_tuning(nullptr, &tuning);
+  if (have_tuning) {
+    std::cerr << "# rxlib: using tuning profile: " << tuning.threads << " threads, "
+              << tuning.init_threads << " init threads" << std::endl;
+  }
+}
+
+static randomx_flags rx_flags() {
+  load_tuning();
+  randomx_flags flags =
+    RANDOMX_FLAG_DEFAULT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_JIT | RANDOMX_FLAG_FULL_MEM | randomx_get_flags();
+#ifdef M1
+  flags |= RANDOMX_FLAG_SECURE;
+#endif
+  if (have_tuning && (tuning.flags & RANDOMX_FLAG_SECURE)) {
+    flags |= RANDOMX_FLAG_SECURE;
+  }
+  return flags;
+}
+
+// Large pages are tried unless the tuning profile found them unavailable or slower.
+static randomx_flags rx_hugepages_flags() {
+  randomx_flags flags = rx_flags();
+  if (!have_tuning || (tuning.flags & RANDOMX_FLAG_LARGE_PAGES)) {
+    flags |= RANDOMX_FLAG_LARGE_PAGES;
+  }
+  return flags;
+}
+
 void set_experimental(bool exp) {
   for (randomx_vm* machine : vm) {
 	machine->setExperimental(exp);
@@ -28,18 +66,15 @@ void set_experimental(bool exp) {
 
 // only call when all existing threads are stopped
 extern "C" int rx_add_thread() {
-  randomx_flags flags, hugepages_flags;
-  flags = RANDOMX_FLAG_DEFAULT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_JIT | RANDOMX_FLAG_FULL_MEM;
-  flags |= randomx_get_flags();
-#ifdef M1
-  flags |= RANDOMX_FLAG_SECURE;
-#endif
-  hugepages_flags = flags | RANDOMX_FLAG_LARGE_PAGES;
+  randomx_flags flags = rx_flags();
+  randomx_flags hugepages_flags = rx_hugepages_flags();
 
   auto v = randomx_create_vm(hugepages_flags, nullptr, dataset);
   if (v == nullptr) {
-    std::cerr << "# rxlib: Failed to allocate rx vm w/ hugepages." << std::endl;
-    v = randomx_create_vm(flags, nullptr, dataset);
+    if (hugepages_flags != flags) {
+      std::cerr << "# rxlib: Failed to allocate rx vm w/ hugepages." << std::endl;
+      v = randomx_create_vm(flags, nullptr, dataset);
+    }
     if (v == nullptr) {
       std::cerr << "# rxlib: Failed to allocate rx vm" << std::endl;
       return -1;
@@ -61,11 +96,10 @@ extern "C" int rx_remove_thread() {
 }
 
 extern "C" bool seed_rxlib(const char* seed_hash, uint32_t len, int init_threads) {
-  randomx_flags flags =
-    RANDOMX_FLAG_DEFAULT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_JIT | RANDOMX_FLAG_FULL_MEM | randomx_get_flags();
-#ifdef M1
-  flags |= RANDOMX_FLAG_SECURE;
-#endif
+  randomx_flags flags = rx_flags();
+  if (init_threads <= 0) {
+    init_threads = have_tuning && tuning.init_threads > 0 ? tuning.init_threads : std::max(1u, std::thread::hardware_concurrency());
+  }
   randomx_cache* cache = randomx_alloc_cache(flags);  
   if (cache == nullptr) {
     std::cerr << "# rxlib: Failed to allocate rx cache" << std::endl;
@@ -97,17 +131,17 @@ extern "C" bool seed_rxlib(const char* seed_hash, uint32_t len, int init_threads
 }
 
 extern "C" int init_rxlib(int threads) {
-  randomx_flags flags =
-    RANDOMX_FLAG_DEFAULT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_JIT | RANDOMX_FLAG_FULL_MEM | randomx_get_flags();
-#ifdef M1
-  flags |= RANDOMX_FLAG_SECURE;
-#endif
-  randomx_flags hugepages_flags = flags | RANDOMX_FLAG_LARGE_PAGES;
+  randomx_flags flags = rx_flags();
+  randomx_flags hugepages_flags = rx_hugepages_flags();
+  if (threads <= 0) {
+    threads = have_tuning && tuning.threads > 0 ? tuning.threads : 1;
+  }
 
   bool hugepages_success = false;
   if (dataset == nullptr) {
     // Allocate a dataset if it hasn't been allocated already.
-    dataset = randomx_alloc_dataset(hugepages_flags);
+    // pages are faulted in by the seed_rxlib init threads
+    dataset = randomx_alloc_dataset(hugepages_flags | RANDOMX_FLAG_FIRST_TOUCH);
     if (dataset == nullptr) {
       std::cerr << "# rxlib: Failed to allocate rx dataset w/ hugepages" << std::endl;
       dataset = randomx_alloc_dataset(flags);
@@ -116,7 +150,13 @@ extern "C" int init_rxlib(int threads) {
         return -1;
       }
     } else {
-      hugepages_success = true;
+      // without huge pages in the tuning profile, none were requested
+      hugepages_success = hugepages_flags != flags;
+    }
+    randomx_page_info info;
+    if (randomx_dataset_page_info(dataset, &info)) {
+      std::cerr << "# rxlib: dataset pages: " << (info.hugetlb_bytes >> 20) << " MiB hugetlb, "
+                << (info.thp_bytes >> 20) << " MiB THP" << std::endl;
     }
   }
 
@@ -125,8 +165,10 @@ extern "C" int init_rxlib(int threads) {
     for (int i=0; i<threads; ++i) {
       auto v = randomx_create_vm(hugepages_flags, nullptr, dataset);
       if (v == nullptr) {
-        std::cerr << "# rxlib: Failed to allocate rx vm w/ hugepages" << std::endl;
-        v = randomx_create_vm(flags, nullptr, dataset);
+        if (hugepages_flags != flags) {
+          std::cerr << "# rxlib: Failed to allocate rx vm w/ hugepages" << std::endl;
+          v = randomx_create_vm(flags, nullptr, dataset);
+        }
         if (v == nullptr) {
           std::cerr << "# rxlib: Failed to allocate rx vm" << std::endl;
           return -1;
@@ -7,8 +7,10 @@
 //   1: success
 //   2: success, but no huge pages.
 //   -1: unexpected failure
+// threads <= 0 uses the thread count of this host's tuning profile (randomx-benchmark --autotune), or 1.
 int init_rxlib(int threads);
 
+// init_threads <= 0 uses the tuning profile's init thread count, or all CPUs.
 bool seed_rxlib(const char* seed_hash, uint32_t len, int init_threads);
 
 int64_t rx_hash_until(const char* blob, uint32_t len, uint64_t diff, int thread, char* hash_output, char* nonce_output, uint32_t* stopper);
@@ -27,24 +27,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "soft_aes.h"
+#include "aes_hash_constants.hpp"
 #include <cassert>
 
 //NOTE: The functions below were tuned for maximum performance
 //and are not cryptographically secure outside of the scope of RandomX.
 //It's not recommended to use them as general hash functions and PRNGs.
 
-//AesHash1R:
-//state0, state1, state2, state3 = Blake2b-512("RandomX AesHash1R state")
-//xkey0, xkey1 = Blake2b-256("RandomX AesHash1R xkeys")
-
-#define AES_HASH_1R_STATE0 0xd7983aad, 0xcc82db47, 0x9fa856de, 0x92b52c0d
-#define AES_HASH_1R_STATE1 0xace78057, 0xf59e125a, 0x15c7b798, 0x338d996e
-#define AES_HASH_1R_STATE2 0xe8a07ce4, 0x5079506b, 0xae62c7d0, 0x6a770017
-#define AES_HASH_1R_STATE3 0x7e994948, 0x79a10005, 0x07ad828d, 0x630a240c
-
-#define AES_HASH_1R_XKEY0 0x06890201, 0x90dc56bf, 0x8b24949f, 0xf6fa8389
-#define AES_HASH_1R_XKEY1 0xed18f99b, 0xee1043c6, 0x51f4e03c, 0x61b263d1
-
 /*
 	Calculate a 512-bit hash of 'input' using 4 lanes of AES.
 	The input is treated as a set of round keys for the encryption
@@ -111,14 +100,6 @@ void hashAes1Rx4(const void *input, size_t inputSize, void *hash) {
 template void hashAes1Rx4<false>(const void *input, size_t inputSize, void *hash);
 template void hashAes1Rx4<true>(const void *input, size_t inputSize, void *hash);
 
-//AesGenerator1R:
-//key0, key1, key2, key3 = Blake2b-512("RandomX AesGenerator1R keys")
-
-#define AES_GEN_1R_KEY0 0xb4f44917, 0xdbb5552b, 0x62716609, 0x6daca553
-#define AES_GEN_1R_KEY1 0x0da1dc4e, 0x1725d378, 0x846a710d, 0x6d7caf07
-#define AES_GEN_1R_KEY2 0x3e20e345, 0xf4c0794f, 0x9f947ec6, 0x3f1262f1
-#define AES_GEN_1R_KEY3 0x49169154, 0x16314c88, 0xb1ba317c, 0x6aef8135
-
 /*
 	Fill 'buffer' with pseudorandom data based on 512-bit 'state'.
 	The state is encrypted using a single AES round per 16 bytes of output
@@ -320,3 +301,133 @@ void hashAndFillAes1Rx4(void *scratchpad, size_t scratchpadSize, void *hash, voi
 
 template void hashAndFillAes1Rx4<false>(void *scratchpad, size_t scratchpadSize, void *hash, void* fill_state);
 template void hashAndFillAes1Rx4<true>(void *scratchpad, size_t scratchpadSize, void *hash, void* fill_state);
+
+//Constant-time versions of the software AES functions above using bitsliced AES.
+//All 4 lanes are processed together; the state stays in bitsliced form between rounds.
+
+static void bitsliceVectors(uint64_t (&q)[8], rx_vec_i128 x0, rx_vec_i128 x1, rx_vec_i128 x2, rx_vec_i128 x3) {
+	alignas(16) rx_vec_i128 blocks[4];
+	rx_store_vec_i128(&blocks[0], x0);
+	rx_store_vec_i128(&blocks[1], x1);
+	rx_store_vec_i128(&blocks[2], x2);
+	rx_store_vec_i128(&blocks[3], x3);
+	soft_aes_bitslice(q, blocks);
+}
+
+static void hashFinishBitsliced(uint64_t (&state)[8], void *hash) {
+	//two extra rounds to achieve full diffusion
+	rx_vec_i128 xkey0 = rx_set_int_vec_i128(AES_HASH_1R_XKEY0);
+	rx_vec_i128 xkey1 = rx_set_int_vec_i128(AES_HASH_1R_XKEY1);
+	uint64_t key[8];
+
+	bitsliceVectors(key, xkey0, xkey0, xkey0, xkey0);
+	soft_aes_round_bitsliced(state, key, SoftAesDecBlocks13);
+	bitsliceVectors(key, xkey1, xkey1, xkey1, xkey1);
+	soft_aes_round_bitsliced(state, key, SoftAesDecBlocks13);
+
+	soft_aes_unbitslice(hash, state);
+}
+
+static void hashInitBitsliced(uint64_t (&state)[8]) {
+	bitsliceVectors(state,
+		rx_set_int_vec_i128(AES_HASH_1R_STATE0),
+		rx_set_int_vec_i128(AES_HASH_1R_STATE1),
+		rx_set_int_vec_i128(AES_HASH_1R_STATE2),
+		rx_set_int_vec_i128(AES_HASH_1R_STATE3));
+}
+
+static void fillKeysBitsliced(uint64_t (&key)[8]) {
+	bitsliceVectors(key,
+		rx_set_int_vec_i128(AES_GEN_1R_KEY0),
+		rx_set_int_vec_i128(AES_GEN_1R_KEY1),
+		rx_set_int_vec_i128(AES_GEN_1R_KEY2),
+		rx_set_int_vec_i128(AES_GEN_1R_KEY3));
+}
+
+void hashAes1Rx4Bitsliced(const void *input, size_t inputSize, void *hash) {
+	assert(inputSize % 64 == 0);
+	const uint8_t* inptr = (uint8_t*)input;
+	const uint8_t* inputEnd = inptr + inputSize;
+	uint64_t state[8], key[8];
+
+	hashInitBitsliced(state);
+
+	while (inptr < inputEnd) {
+		soft_aes_bitslice(key, inptr);
+		soft_aes_round_bitsliced(state, key, SoftAesDecBlocks13);
+		inptr += 64;
+	}
+
+	hashFinishBitsliced(state, hash);
+}
+
+void fillAes1Rx4Bitsliced(void *state, size_t outputSize, void *buffer) {
+	assert(outputSize % 64 == 0);
+	uint8_t* outptr = (uint8_t*)buffer;
+	const uint8_t* outputEnd = outptr + outputSize;
+	uint64_t fill[8], key[8];
+
+	fillKeysBitsliced(key);
+	soft_aes_bitslice(fill, state);
+
+	while (outptr < outputEnd) {
+		soft_aes_round_bitsliced(fill, key, SoftAesDecBlocks02);
+		soft_aes_unbitslice(outptr, fill);
+		outptr += 64;
+	}
+
+	soft_aes_unbitslice(state, fill);
+}
+
+void fillAes4Rx4Bitsliced(void *state, size_t outputSize, void *buffer) {
+	assert(outputSize % 64 == 0);
+	uint8_t* outptr = (uint8_t*)buffer;
+	const uint8_t* outputEnd = outptr + outputSize;
+	uint64_t fill[8], key[4][8];
+
+	//states 0 and 1 use keys 0-3, states 2 and 3 use keys 4-7
+	rx_vec_i128 key0 = rx_set_int_vec_i128(AES_GEN_4R_KEY0);
+	rx_vec_i128 key1 = rx_set_int_vec_i128(AES_GEN_4R_KEY1);
+	rx_vec_i128 key2 = rx_set_int_vec_i128(AES_GEN_4R_KEY2);
+	rx_vec_i128 key3 = rx_set_int_vec_i128(AES_GEN_4R_KEY3);
+	rx_vec_i128 key4 = rx_set_int_vec_i128(AES_GEN_4R_KEY4);
+	rx_vec_i128 key5 = rx_set_int_vec_i128(AES_GEN_4R_KEY5);
+	rx_vec_i128 key6 = rx_set_int_vec_i128(AES_GEN_4R_KEY6);
+	rx_vec_i128 key7 = rx_set_int_vec_i128(AES_GEN_4R_KEY7);
+	bitsliceVectors(key[0], key0, key0, key4, key4);
+	bitsliceVectors(key[1], key1, key1, key5, key5);
+	bitsliceVectors(key[2], key2, key2, key6, key6);
+	bitsliceVectors(key[3], key3, key3, key7, key7);
+
+	soft_aes_bitslice(fill, state);
+
+	while (outptr < outputEnd) {
+		soft_aes_round_bitsliced(fill, key[0], SoftAesDecBlocks02);
+		soft_aes_round_bitsliced(fill, key[1], SoftAesDecBlocks02);
+		soft_aes_round_bitsliced(fill, key[2], SoftAesDecBlocks02);
+		soft_aes_round_bitsliced(fill, key[3], SoftAesDecBlocks02);
+		soft_aes_unbitslice(outptr, fill);
+		outptr += 64;
+	}
+}
+
+void hashAndFillAes1Rx4Bitsliced(void *scratchpad, size_t scratchpadSize, void *hash, void* fill_state) {
+	uint8_t* scratchpadPtr = (uint8_t*)scratchpad;
+	const uint8_t* scratchpadEnd = scratchpadPtr + scratchpadSize;
+	uint64_t hashState[8], fill[8], fillKey[8], key[8];
+
+	hashInitBitsliced(hashState);
+	fillKeysBitsliced(fillKey);
+	soft_aes_bitslice(fill, fill_state);
+
+	while (scratchpadPtr < scratchpadEnd) {
+		soft_aes_bitslice(key, scratchpadPtr);
+		soft_aes_round_bitsliced(hashState, key, SoftAesDecBlocks13);
+		soft_aes_round_bitsliced(fill, fillKey, SoftAesDecBlocks02);
+		soft_aes_unbitslice(scratchpadPtr, fill);
+		scratchpadPtr += 64;
+	}
+
+	soft_aes_unbitslice(fill_state, fill);
+	hashFinishBitsliced(hashState, hash);
+}
@@ -41,3 +41,33 @@ void fillAes4Rx4(void *state, size_t outputSize, void *buffer);
 
 template<bool softAes>
 void hashAndFillAes1Rx4(void *scratchpad, size_t scratchpadSize, void *hash, void* fill_state);
+
+//Constant-time software AES versions of the functions above (bitsliced, no table lookups).
+void hashAes1Rx4Bitsliced(const void *input, size_t inputSize, void *hash);
+
+void fillAes1Rx4Bitsliced(void *state, size_t outputSize, void *buffer);
+
+void fillAes4Rx4Bitsliced(void *state, size_t outputSize, void *buffer);
+
+void hashAndFillAes1Rx4Bitsliced(void *scratchpad, size_t scratchpadSize, void *hash, void* fill_state);
+
+//Versions of the functions above processing 2 or 4 independent buffers at once
+//with VAES. The results are identical to the hardware AES versions.
+//Use only if hasVaesKernels() and the CPU supports VAES and AVX2. 4 buffers
+//additionally need hasVaes512Kernels() and AVX-512.
+bool hasVaesKernels();
+
+bool hasVaes512Kernels();
+
+void hashAes1Rx4Vaes(unsigned count, const void* const input[], size_t inputSize, void* const hash[]);
+
+void fillAes1Rx4Vaes(unsigned count, void* const state[], size_t outputSize, void* const buffer[]);
+
+void hashAndFillAes1Rx4Vaes(unsigned count, void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]);
+
+//4-buffer kernels used by the functions above (aes_hash_vaes512.cpp)
+void hashAes1Rx4Vaes512(const void* const input[], size_t inputSize, void* const hash[]);
+
+void fillAes1Rx4Vaes512(void* const state[], size_t outputSize, void* const buffer[]);
+
+void hashAndFillAes1Rx4Vaes512(void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]);
@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstdint>
+#include "aes_hash.hpp"
+
+//Dispatch of the multi-buffer AES functions and the 2-buffer (256-bit) kernels.
+//This file is compiled with AVX2/VAES enabled, so it must not include headers
+//with inline code shared with other files. The 4-buffer kernels need AVX-512
+//and are in aes_hash_vaes512.cpp.
+
+#if defined(__VAES__) && defined(__AVX2__)
+
+#include "aes_hash_vaes.hpp"
+
+namespace {
+
+	//Blocks of 64 bytes are transposed so that memory is accessed with full-width
+	//loads and stores instead of inserting/extracting individual 128-bit lanes.
+
+	struct Vaes256 {
+		typedef __m256i vec;
+		static inline vec broadcast(__m128i x) {
+			return _mm256_broadcastsi128_si256(x);
+		}
+		static inline void load(const void* const ptr[], size_t offset, vec (&x)[4]) {
+			vec a0 = _mm256_loadu_si256((const __m256i*)((const uint8_t*)ptr[0] + offset));
+			vec a1 = _mm256_loadu_si256((const __m256i*)((const uint8_t*)ptr[0] + offset + 32));
+			vec b0 = _mm256_loadu_si256((const __m256i*)((const uint8_t*)ptr[1] + offset));
+			vec b1 = _mm256_loadu_si256((const __m256i*)((const uint8_t*)ptr[1] + offset + 32));
+			x[0] = _mm256_permute2x128_si256(a0, b0, 0x20);
+			x[1] = _mm256_permute2x128_si256(a0, b0, 0x31);
+			x[2] = _mm256_permute2x128_si256(a1, b1, 0x20);
+			x[3] = _mm256_permute2x128_si256(a1, b1, 0x31);
+		}
+		static inline void store(void* const ptr[], size_t offset, const vec (&x)[4]) {
+			_mm256_storeu_si256((__m256i*)((uint8_t*)ptr[0] + offset), _mm256_permute2x128_si256(x[0], x[1], 0x20));
+			_mm256_storeu_si256((__m256i*)((uint8_t*)ptr[0] + offset + 32), _mm256_permute2x128_si256(x[2], x[3], 0x20));
+			_mm256_storeu_si256((__m256i*)((uint8_t*)ptr[1] + offset), _mm256_permute2x128_si256(x[0], x[1], 0x31));
+			_mm256_storeu_si256((__m256i*)((uint8_t*)ptr[1] + offset + 32), _mm256_permute2x128_si256(x[2], x[3], 0x31));
+		}
+		static inline vec aesenc(vec x, vec key) {
+			return _mm256_aesenc_epi128(x, key);
+		}
+		static inline vec aesdec(vec x, vec key) {
+			return _mm256_aesdec_epi128(x, key);
+		}
+	};
+
+}
+
+bool hasVaesKernels() {
+	return true;
+}
+
+void hashAes1Rx4Vaes(unsigned count, const void* const input[], size_t inputSize, void* const hash[]) {
+	if (count == 4)
+		hashAes1Rx4Vaes512(input, inputSize, hash);
+	else
+		hashAes1Rx4<Vaes256>(input, inputSize, hash);
+}
+
+void fillAes1Rx4Vaes(unsigned count, void* const state[], size_t outputSize, void* const buffer[]) {
+	if (count == 4)
+		fillAes1Rx4Vaes512(state, outputSize, buffer);
+	else
+		fillAes1Rx4<Vaes256>(state, outputSize, buffer);
+}
+
+void hashAndFillAes1Rx4Vaes(unsigned count, void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]) {
+	if (count == 4)
+		hashAndFillAes1Rx4Vaes512(scratchpad, scratchpadSize, hash, fillState);
+	else
+		hashAndFillAes1Rx4<Vaes256>(scratchpad, scratchpadSize, hash, fillState);
+}
+
+#else
+
+bool hasVaesKernels() {
+	return false;
+}
+
+void hashAes1Rx4Vaes(unsigned count, const void* const input[], size_t inputSize, void* const hash[]) {
+	for (unsigned i = 0; i < count; ++i)
+		hashAes1Rx4<false>(input[i], inputSize, hash[i]);
+}
+
+void fillAes1Rx4Vaes(unsigned count, void* const state[], size_t outputSize, void* const buffer[]) {
+	for (unsigned i = 0; i < count; ++i)
+		fillAes1Rx4<false>(state[i], outputSize, buffer[i]);
+}
+
+void hashAndFillAes1Rx4Vaes(unsigned count, void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]) {
+	for (unsigned i = 0; i < count; ++i)
+		hashAndFillAes1Rx4<false>(scratchpad[i], scratchpadSize, hash[i], fillState[i]);
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+//Multi-buffer AesHash1R/AesGenerator1R templates shared by aes_hash_vaes.cpp (2 buffers,
+//256-bit registers) and aes_hash_vaes512.cpp (4 buffers, 512-bit registers).
+//The same state index of every buffer is kept in one register, so one VAES
+//instruction performs the round for all of them. Include only from those two files:
+//everything here is compiled with their instruction set flags and has internal linkage.
+
+#include <cstdint>
+#include <cstddef>
+#include <immintrin.h>
+#include "aes_hash_constants.hpp"
+
+namespace {
+
+	template<class V>
+	inline void hashRound(typename V::vec (&state)[4], const typename V::vec (&key)[4]) {
+		state[0] = V::aesenc(state[0], key[0]);
+		state[1] = V::aesdec(state[1], key[1]);
+		state[2] = V::aesenc(state[2], key[2]);
+		state[3] = V::aesdec(state[3], key[3]);
+	}
+
+	template<class V>
+	inline void fillRound(typename V::vec (&state)[4], const typename V::vec (&key)[4]) {
+		state[0] = V::aesdec(state[0], key[0]);
+		state[1] = V::aesenc(state[1], key[1]);
+		state[2] = V::aesdec(state[2], key[2]);
+		state[3] = V::aesenc(state[3], key[3]);
+	}
+
+	template<class V>
+	inline void hashInit(typename V::vec (&state)[4]) {
+		state[0] = V::broadcast(_mm_set_epi32(AES_HASH_1R_STATE0));
+		state[1] = V::broadcast(_mm_set_epi32(AES_HASH_1R_STATE1));
+		state[2] = V::broadcast(_mm_set_epi32(AES_HASH_1R_STATE2));
+		state[3] = V::broadcast(_mm_set_epi32(AES_HASH_1R_STATE3));
+	}
+
+	template<class V>
+	inline void fillInit(typename V::vec (&key)[4]) {
+		key[0] = V::broadcast(_mm_set_epi32(AES_GEN_1R_KEY0));
+		key[1] = V::broadcast(_mm_set_epi32(AES_GEN_1R_KEY1));
+		key[2] = V::broadcast(_mm_set_epi32(AES_GEN_1R_KEY2));
+		key[3] = V::broadcast(_mm_set_epi32(AES_GEN_1R_KEY3));
+	}
+
+	template<class V>
+	inline void hashFinish(typename V::vec (&state)[4], void* const hash[]) {
+		typename V::vec xkey0 = V::broadcast(_mm_set_epi32(AES_HASH_1R_XKEY0));
+		typename V::vec xkey1 = V::broadcast(_mm_set_epi32(AES_HASH_1R_XKEY1));
+		const typename V::vec key0[4] = { xkey0, xkey0, xkey0, xkey0 };
+		const typename V::vec key1[4] = { xkey1, xkey1, xkey1, xkey1 };
+
+		hashRound<V>(state, key0);
+		hashRound<V>(state, key1);
+
+		V::store(hash, 0, state);
+	}
+
+	template<class V>
+	void hashAes1Rx4(const void* const input[], size_t inputSize, void* const hash[]) {
+		typename V::vec state[4], in[4];
+		hashInit<V>(state);
+
+		for (size_t offset = 0; offset < inputSize; offset += 64) {
+			V::load(input, offset, in);
+			hashRound<V>(state, in);
+		}
+
+		hashFinish<V>(state, hash);
+	}
+
+	template<class V>
+	void fillAes1Rx4(void* const state[], size_t outputSize, void* const buffer[]) {
+		typename V::vec key[4], fill[4];
+		fillInit<V>(key);
+		V::load(state, 0, fill);
+
+		for (size_t offset = 0; offset < outputSize; offset += 64) {
+			fillRound<V>(fill, key);
+			V::store(buffer, offset, fill);
+		}
+
+		V::store(state, 0, fill);
+	}
+
+	template<class V>
+	void hashAndFillAes1Rx4(void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]) {
+		typename V::vec key[4], fill[4], state[4], in[4];
+		fillInit<V>(key);
+		hashInit<V>(state);
+		V::load(fillState, 0, fill);
+
+		for (size_t offset = 0; offset < scratchpadSize; offset += 64) {
+			V::load(scratchpad, offset, in);
+			hashRound<V>(state, in);
+			fillRound<V>(fill, key);
+			V::store(scratchpad, offset, fill);
+		}
+
+		V::store(fillState, 0, fill);
+		hashFinish<V>(state, hash);
+	}
+}
@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstdint>
+#include "aes_hash.hpp"
+
+//4-buffer (512-bit) multi-buffer AES kernels. This file is compiled with
+//AVX-512/VAES enabled, so it must not include headers with inline code
+//shared with other files.
+
+#if defined(__VAES__) && defined(__AVX512F__)
+
+#include "aes_hash_vaes.hpp"
+
+namespace {
+
+	struct Vaes512 {
+		typedef __m512i vec;
+		static inline vec broadcast(__m128i x) {
+			return _mm512_broadcast_i32x4(x);
+		}
+		//4x4 transpose of 128-bit lanes (its own inverse)
+		static inline void transpose(const vec (&in)[4], vec (&out)[4]) {
+			vec t0 = _mm512_shuffle_i64x2(in[0], in[1], 0x44);
+			vec t1 = _mm512_shuffle_i64x2(in[0], in[1], 0xee);
+			vec t2 = _mm512_shuffle_i64x2(in[2], in[3], 0x44);
+			vec t3 = _mm512_shuffle_i64x2(in[2], in[3], 0xee);
+			out[0] = _mm512_shuffle_i64x2(t0, t2, 0x88);
+			out[1] = _mm512_shuffle_i64x2(t0, t2, 0xdd);
+			out[2] = _mm512_shuffle_i64x2(t1, t3, 0x88);
+			out[3] = _mm512_shuffle_i64x2(t1, t3, 0xdd);
+		}
+		static inline void load(const void* const ptr[], size_t offset, vec (&x)[4]) {
+			vec blocks[4];
+			for (int i = 0; i < 4; ++i)
+				blocks[i] = _mm512_loadu_si512((const uint8_t*)ptr[i] + offset);
+			transpose(blocks, x);
+		}
+		static inline void store(void* const ptr[], size_t offset, const vec (&x)[4]) {
+			vec blocks[4];
+			transpose(x, blocks);
+			for (int i = 0; i < 4; ++i)
+				_mm512_storeu_si512((uint8_t*)ptr[i] + offset, blocks[i]);
+		}
+		static inline vec aesenc(vec x, vec key) {
+			return _mm512_aesenc_epi128(x, key);
+		}
+		static inline vec aesdec(vec x, vec key) {
+			return _mm512_aesdec_epi128(x, key);
+		}
+	};
+
+}
+
+bool hasVaes512Kernels() {
+	return true;
+}
+
+void hashAes1Rx4Vaes512(const void* const input[], size_t inputSize, void* const hash[]) {
+	hashAes1Rx4<Vaes512>(input, inputSize, hash);
+}
+
+void fillAes1Rx4Vaes512(void* const state[], size_t outputSize, void* const buffer[]) {
+	fillAes1Rx4<Vaes512>(state, outputSize, buffer);
+}
+
+void hashAndFillAes1Rx4Vaes512(void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]) {
+	hashAndFillAes1Rx4<Vaes512>(scratchpad, scratchpadSize, hash, fillState);
+}
+
+#else
+
+bool hasVaes512Kernels() {
+	return false;
+}
+
+void hashAes1Rx4Vaes512(const void* const input[], size_t inputSize, void* const hash[]) {
+	for (unsigned i = 0; i < 4; ++i)
+		hashAes1Rx4<false>(input[i], inputSize, hash[i]);
+}
+
+void fillAes1Rx4Vaes512(void* const state[], size_t outputSize, void* const buffer[]) {
+	for (unsigned i = 0; i < 4; ++i)
+		fillAes1Rx4<false>(state[i], outputSize, buffer[i]);
+}
+
+void hashAndFillAes1Rx4Vaes512(void* const scratchpad[], size_t scratchpadSize, void* const hash[], void* const fillState[]) {
+	for (unsigned i = 0; i < 4; ++i)
+		hashAndFillAes1Rx4<false>(scratchpad[i], scratchpadSize, hash[i], fillState[i]);
+}
+
+#endif
@@ -26,7 +26,11 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
 #include <new>
+#include <mutex>
+#include <vector>
+#include <stdexcept>
 #include "allocator.hpp"
 #include "intrin_portable.h"
 #include "virtual_memory.hpp"
@@ -57,4 +61,106 @@ namespace randomx {
 		freePagedMemory(ptr, count);
 	};
 
-}
\ No newline at end of file
+	void* LargePageFirstTouchAllocator::allocMemory(size_t count) {
+		return allocLargePagesMemory(count, false);
+	}
+
+	void LargePageFirstTouchAllocator::freeMemory(void* ptr, size_t count) {
+		freePagedMemory(ptr, count);
+	};
+
+	namespace {
+
+		constexpr size_t ArenaGigaPageSize = 1024 * 1024 * 1024;
+		constexpr size_t ArenaLargePageSize = 2 * 1024 * 1024;
+		//offsets below 4 KiB in cache-line multiples change the L1/L2 set index
+		constexpr unsigned ArenaMaxColours = 16;
+		constexpr size_t ArenaColourStride = 4096 / ArenaMaxColours;
+
+		struct ArenaRegion {
+			uint8_t* base;
+			size_t size;
+			size_t slotSize;
+			std::vector<bool> used;
+			size_t usedCount;
+		};
+
+		std::mutex arenaMutex;
+		std::vector<ArenaRegion> arenaRegions;
+		unsigned arenaColours = 1;
+		unsigned arenaNextColour = 0;
+
+		//a 1 GiB page is used only if at least half of it would be filled
+		ArenaRegion newArenaRegion(size_t slotSize, size_t slots) {
+			ArenaRegion region;
+			region.slotSize = slotSize;
+			region.usedCount = 0;
+			region.size = alignSize(slots * slotSize, ArenaLargePageSize);
+			region.base = nullptr;
+			if (region.size >= ArenaGigaPageSize / 2) {
+				try {
+					region.base = (uint8_t*)allocGigaPagesMemory(ArenaGigaPageSize);
+					region.size = ArenaGigaPageSize;
+				}
+				catch (std::exception&) {
+				}
+			}
+			if (region.base == nullptr)
+				region.base = (uint8_t*)allocLargePagesMemory(region.size);
+			region.used.resize(region.size / slotSize);
+			return region;
+		}
+
+	}
+
+	void* ScratchpadArenaAllocator::allocMemory(size_t count) {
+		if (count > ScratchpadSize)
+			throw std::bad_alloc();
+		std::lock_guard<std::mutex> lock(arenaMutex);
+		//slots stay aligned to large pages; a coloured scratchpad starts at an offset within its slot
+		const size_t slotSize = alignSize(ScratchpadSize + (arenaColours - 1) * ArenaColourStride, ArenaLargePageSize);
+		for (;;) {
+			for (auto& region : arenaRegions) {
+				if (region.slotSize != slotSize || region.usedCount == region.used.size())
+					continue;
+				for (size_t i = 0; i < region.used.size(); ++i) {
+					if (!region.used[i]) {
+						region.used[i] = true;
+						region.usedCount++;
+						unsigned colour = arenaNextColour++ % arenaColours;
+						return region.base + i * slotSize + colour * ArenaColourStride;
+					}
+				}
+			}
+			//each new region is as large as all regions in use, so the arena grows
+			//with the number of VMs instead of being reserved up front
+			size_t slotsInUse = 0;
+			for (auto& region : arenaRegions) {
+				if (region.slotSize == slotSize)
+					slotsInUse += region.usedCount;
+			}
+			arenaRegions.push_back(newArenaRegion(slotSize, std::max<size_t>(slotsInUse, 1)));
+		}
+	}
+
+	void ScratchpadArenaAllocator::freeMemory(void* ptr, size_t count) {
+		std::lock_guard<std::mutex> lock(arenaMutex);
+		for (auto it = arenaRegions.begin(); it != arenaRegions.end(); ++it) {
+			if ((uint8_t*)ptr < it->base || (uint8_t*)ptr >= it->base + it->size)
+				continue;
+			it->used[((uint8_t*)ptr - it->base) / it->slotSize] = false;
+			if (--it->usedCount == 0) {
+				freePagedMemory(it->base, it->size);
+				arenaRegions.erase(it);
+			}
+			return;
+		}
+	}
+
+	void ScratchpadArenaAllocator::setColours(unsigned colours) {
+		std::lock_guard<std::mutex> lock(arenaMutex);
+		arenaColours = colours < 1 ? 1 : (colours > ArenaMaxColours ? ArenaMaxColours : colours);
+		arenaNextColour = 0;
+	}
+
+}
@@ -43,4 +43,20 @@ namespace randomx {
 		static void freeMemory(void*, size_t);
 	};
 
+	//Large pages that are not prefaulted when allocated
+	struct LargePageFirstTouchAllocator {
+		static void* allocMemory(size_t);
+		static void freeMemory(void*, size_t);
+	};
+
+	//Hands out scratchpads from shared large-page regions, so many VMs need only a few
+	//mappings. Regions double in size as VMs are added; 1 GiB pages are used (if available)
+	//once a region would take at least 512 MiB.
+	struct ScratchpadArenaAllocator {
+		static void* allocMemory(size_t);
+		static void freeMemory(void*, size_t);
+		//offsets consecutive scratchpads by 0, 256, 512 ... bytes, cycling after the given number of colours
+		static void setColours(unsigned colours);
+	};
+
 }
\ No newline at end of file
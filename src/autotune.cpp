@@ -0,0 +1,308 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "autotune.hpp"
+#include "cpu.hpp"
+#include "common.hpp"
+#include "blake2/endian.h"
+
+namespace randomx {
+
+	static uint64_t physicalMemory() {
+#if defined(_WIN32) || defined(__CYGWIN__)
+		MEMORYSTATUSEX status;
+		status.dwLength = sizeof(status);
+		return GlobalMemoryStatusEx(&status) ? status.ullTotalPhys : 0;
+#elif defined(_SC_PHYS_PAGES)
+		long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+		return pages > 0 && pageSize > 0 ? (uint64_t)pages * pageSize : 0;
+#else
+		return 0;
+#endif
+	}
+
+	static std::string cpuModel() {
+		Cpu cpu;
+		std::string model(cpu.brand());
+#if defined(__linux__)
+		if (model.empty()) {
+			//no brand string on ARM, use what the kernel reports
+			std::ifstream cpuinfo("/proc/cpuinfo");
+			std::string line;
+			while (model.empty() && std::getline(cpuinfo, line)) {
+				if (line.compare(0, 10, "model name") == 0 || line.compare(0, 8, "CPU part") == 0 || line.compare(0, 8, "Hardware") == 0)
+					model = line.substr(line.find(':') + 1);
+			}
+		}
+#endif
+		auto first = model.find_first_not_of(" \t");
+		auto last = model.find_last_not_of(" \t");
+		return first == std::string::npos ? "unknown CPU" : model.substr(first, last - first + 1);
+	}
+
+	std::string tuningHostKey() {
+		std::ostringstream key;
+		//rounded so that memory reserved by the firmware or kernel does not change the key
+		key << cpuModel() << " / " << (physicalMemory() + (512 << 20)) / (1 << 30) << " GiB";
+		return key.str();
+	}
+
+	//hashes per second of `threads` VMs hashing in parallel for about trialMs
+	static double hashTrial(randomx_flags flags, randomx_cache* cache, randomx_dataset* dataset, unsigned threads, unsigned trialMs) {
+		std::vector<randomx_vm*> vms;
+		for (unsigned i = 0; i < threads; ++i) {
+			randomx_vm* vm = randomx_create_vm(flags, cache, dataset);
+			if (vm == nullptr)
+				break;
+			vms.push_back(vm);
+		}
+		double hashrate = -1;
+		if (vms.size() == threads) {
+			std::atomic<bool> stop(false);
+			std::vector<uint64_t> hashes(threads);
+			std::vector<std::thread> workers;
+			auto start = std::chrono::steady_clock::now();
+			for (unsigned i = 0; i < threads; ++i) {
+				workers.push_back(std::thread([&, i]() {
+					uint8_t input[76] = {};
+					uint8_t output[RANDOMX_HASH_SIZE];
+					uint32_t nonce = i << 24;
+					store32(input + 39, nonce);
+					randomx_calculate_hash_first(vms[i], input, sizeof(input));
+					while (!stop.load(std::memory_order_relaxed)) {
+						store32(input + 39, ++nonce);
+						randomx_calculate_hash_next(vms[i], input, sizeof(input), output);
+						hashes[i]++;
+					}
+					randomx_calculate_hash_last(vms[i], output);
+				}));
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(trialMs));
+			stop = true;
+			auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			uint64_t total = 0;
+			for (unsigned i = 0; i < threads; ++i) {
+				workers[i].join();
+				total += hashes[i];
+			}
+			hashrate = total / elapsed;
+		}
+		for (auto vm : vms)
+			randomx_destroy_vm(vm);
+		return hashrate;
+	}
+
+	//dataset items per second computed by `threads` threads
+	static double initTrial(randomx_cache* cache, randomx_dataset* scratch, unsigned threads, unsigned itemsPerThread) {
+		std::vector<std::thread> workers;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < threads; ++i)
+			workers.push_back(std::thread(&randomx_init_dataset, scratch, cache, i * itemsPerThread, itemsPerThread));
+		for (auto& worker : workers)
+			worker.join();
+		return threads * itemsPerThread / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//tries 1, 2, ... threads and stops once two steps in a row are more than 10% below the best
+	template<class Trial>
+	static unsigned bestThreadCount(unsigned maxThreads, double& best, Trial trial) {
+		unsigned bestThreads = 1, worse = 0;
+		best = 0;
+		for (unsigned threads = 1; threads <= maxThreads && worse < 2; ++threads) {
+			double rate = trial(threads);
+			if (rate < 0)
+				break;
+			if (rate > best) {
+				best = rate;
+				bestThreads = threads;
+			}
+			worse = rate < 0.9 * best ? worse + 1 : 0;
+		}
+		return bestThreads;
+	}
+
+	void autotune(randomx_tuning* tuning, randomx_dataset* dataset, unsigned maxThreads, unsigned trialMs) {
+		if (maxThreads == 0)
+			maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		randomx_flags flags = randomx_get_flags();
+
+		//large pages are used if they are actually backed by huge pages (reserved or THP)
+		randomx_cache* cache = randomx_alloc_cache(flags | RANDOMX_FLAG_LARGE_PAGES);
+		randomx_page_info info;
+		if (cache != nullptr && randomx_cache_page_info(cache, &info) && info.hugetlb_bytes + info.thp_bytes >= info.size / 2) {
+			flags |= RANDOMX_FLAG_LARGE_PAGES;
+		}
+		else {
+			if (cache != nullptr)
+				randomx_release_cache(cache);
+			cache = randomx_alloc_cache(flags);
+			if (cache == nullptr)
+				throw std::bad_alloc();
+		}
+		const char key[] = "RandomX autotune";
+		randomx_init_cache(cache, key, sizeof(key) - 1);
+
+		//W^X is never faster, so it is not measured; it is only the fallback for platforms that require it
+		if (flags & RANDOMX_FLAG_JIT) {
+			randomx_vm* vm = randomx_create_vm(flags, cache, nullptr);
+			if (vm == nullptr)
+				flags |= RANDOMX_FLAG_SECURE;
+			else
+				randomx_destroy_vm(vm);
+		}
+
+		const unsigned itemsPerThread = 32768;
+		randomx_dataset* scratch = randomx_alloc_dataset_partial(RANDOMX_FLAG_DEFAULT, std::min<unsigned long>(itemsPerThread * maxThreads, randomx_dataset_item_count()));
+		double initRate = 0;
+		unsigned initThreads = maxThreads;
+		if (scratch != nullptr) {
+			unsigned maxInit = std::min<unsigned>(maxThreads, randomx_dataset_item_count() / itemsPerThread);
+			initThreads = bestThreadCount(maxInit, initRate, [&](unsigned threads) {
+				return initTrial(cache, scratch, threads, itemsPerThread);
+			});
+			randomx_release_dataset(scratch);
+		}
+
+		//full mode with the caller's dataset, otherwise light mode with the trial cache
+		randomx_flags vmFlags = dataset != nullptr ? flags | RANDOMX_FLAG_FULL_MEM : flags;
+		double hashrate;
+		unsigned threads = bestThreadCount(maxThreads, hashrate, [&](unsigned threads) {
+			return hashTrial(vmFlags, cache, dataset, threads, trialMs);
+		});
+		randomx_release_cache(cache);
+
+		tuning->flags = flags;
+		tuning->threads = threads;
+		tuning->init_threads = initThreads;
+		tuning->affinity = 0;
+		tuning->hashrate = hashrate;
+		tuning->full_mem = dataset != nullptr;
+	}
+
+	std::string defaultTuningPath() {
+		const char* path = getenv("RANDOMX_TUNING");
+		if (path != nullptr && *path != 0)
+			return path;
+#if defined(_WIN32) || defined(__CYGWIN__)
+		const char* home = getenv("USERPROFILE");
+#else
+		const char* home = getenv("HOME");
+#endif
+		return std::string(home != nullptr ? home : ".") + "/.randomx-tuning";
+	}
+
+	//the file holds one "[host key]" section with key=value lines per host
+	static std::vector<std::pair<std::string, std::vector<std::string>>> readSections(const std::string& path) {
+		std::vector<std::pair<std::string, std::vector<std::string>>> sections;
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line)) {
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (line.size() >= 2 && line.front() == '[' && line.back() == ']')
+				sections.push_back(std::make_pair(line.substr(1, line.size() - 2), std::vector<std::string>()));
+			else if (!sections.empty() && !line.empty() && line[0] != '#')
+				sections.back().second.push_back(line);
+		}
+		return sections;
+	}
+
+	bool saveTuning(const std::string& path, const randomx_tuning* tuning) {
+		auto host = tuningHostKey();
+		auto sections = readSections(path);
+		std::ostringstream out;
+		out << "# RandomX tuning profiles, one section per CPU model and memory size" << std::endl;
+		for (auto& section : sections) {
+			if (section.first == host)
+				continue;
+			out << "[" << section.first << "]" << std::endl;
+			for (auto& line : section.second)
+				out << line << std::endl;
+		}
+		out << "[" << host << "]" << std::endl;
+		out << "flags=" << (int)tuning->flags << std::endl;
+		out << "threads=" << tuning->threads << std::endl;
+		out << "init_threads=" << tuning->init_threads << std::endl;
+		out << "affinity=" << tuning->affinity << std::endl;
+		out << "hashrate=" << tuning->hashrate << std::endl;
+		out << "full_mem=" << tuning->full_mem << std::endl;
+		std::ofstream file(path, std::ios::trunc);
+		file << out.str();
+		return (bool)file;
+	}
+
+	bool loadTuning(const std::string& path, randomx_tuning* tuning) {
+		auto host = tuningHostKey();
+		for (auto& section : readSections(path)) {
+			if (section.first != host)
+				continue;
+			randomx_tuning result = {};
+			for (auto& line : section.second) {
+				auto eq = line.find('=');
+				if (eq == std::string::npos)
+					continue;
+				std::string name = line.substr(0, eq);
+				const char* value = line.c_str() + eq + 1;
+				if (name == "flags")
+					result.flags = (randomx_flags)strtol(value, nullptr, 10);
+				else if (name == "threads")
+					result.threads = (unsigned)strtoul(value, nullptr, 10);
+				else if (name == "init_threads")
+					result.init_threads = (unsigned)strtoul(value, nullptr, 10);
+				else if (name == "affinity")
+					result.affinity = strtoull(value, nullptr, 10);
+				else if (name == "hashrate")
+					result.hashrate = strtod(value, nullptr);
+				else if (name == "full_mem")
+					result.full_mem = (int)strtol(value, nullptr, 10);
+			}
+			if (result.threads == 0)
+				return false;
+			*tuning = result;
+			return true;
+		}
+		return false;
+	}
+}
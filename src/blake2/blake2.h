@@ -92,6 +92,7 @@ extern "C" {
 #define blake2b_final       randomx_blake2b_final
 #define blake2b             randomx_blake2b
 #define blake2b_long        randomx_blake2b_long
+#define blake2b_many        randomx_blake2b_many
 
 	/* Streaming API */
 	int blake2b_init(blake2b_state *S, size_t outlen);
@@ -109,6 +110,26 @@ extern "C" {
 	int blake2b_long(void *out, size_t outlen, const void *in, size_t inlen);
 	/* Argon2 Team - End Code */
 
+	/* Unkeyed hashes of count messages of the same length */
+	int blake2b_many(void *const out[], size_t outlen, const void *const in[],
+		size_t inlen, unsigned count);
+
+	/* SIMD implementations (NULL if not supported by the compiler) */
+	typedef void blake2b_compress_impl(blake2b_state *S, const uint8_t *block);
+	typedef void blake2b_multi_impl(void *const out[], size_t outlen,
+		const void *const in[], size_t inlen);
+
+	blake2b_compress_impl *randomx_blake2b_compress_avx2(void);
+	blake2b_multi_impl *randomx_blake2b_4way_avx2(void);
+	blake2b_multi_impl *randomx_blake2b_8way_avx512(void);
+
+	/* Selects the implementations used by all blake2b functions. Must be
+	   called before any hashing starts. Passing zeros selects the reference code. */
+	void randomx_blake2b_select_impl(int avx2, int avx512f);
+
+	/* Number of messages hashed in parallel by blake2b_many (1 = no SIMD) */
+	unsigned randomx_blake2b_lanes(void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -179,7 +179,7 @@ int blake2b_init_key(blake2b_state *S, size_t outlen, const void *key, size_t ke
 	return 0;
 }
 
-static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
+static void blake2b_compress_ref(blake2b_state *S, const uint8_t *block) {
 	uint64_t m[16];
 	uint64_t v[16];
 	unsigned int i, r;
@@ -237,6 +237,33 @@ static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
 #undef ROUND
 }
 
+static blake2b_compress_impl *blake2b_compress = &blake2b_compress_ref;
+static blake2b_multi_impl *blake2b_4way = NULL;
+static blake2b_multi_impl *blake2b_8way = NULL;
+
+void randomx_blake2b_select_impl(int avx2, int avx512f) {
+	blake2b_compress = &blake2b_compress_ref;
+	blake2b_4way = NULL;
+	blake2b_8way = NULL;
+	if (avx2 && randomx_blake2b_compress_avx2() != NULL) {
+		blake2b_compress = randomx_blake2b_compress_avx2();
+		blake2b_4way = randomx_blake2b_4way_avx2();
+	}
+	if (avx512f) {
+		blake2b_8way = randomx_blake2b_8way_avx512();
+	}
+}
+
+unsigned randomx_blake2b_lanes(void) {
+	if (blake2b_8way != NULL) {
+		return 8;
+	}
+	if (blake2b_4way != NULL) {
+		return 4;
+	}
+	return 1;
+}
+
 int blake2b_update(blake2b_state *S, const void *in, size_t inlen) {
 	const uint8_t *pin = (const uint8_t *)in;
 
@@ -407,3 +434,36 @@ fail:
 }
 /* Argon2 Team - End Code */
 
+int blake2b_many(void *const out[], size_t outlen, const void *const in[],
+	size_t inlen, unsigned count) {
+	unsigned i;
+
+	if (NULL == out || NULL == in || outlen == 0 || outlen > BLAKE2B_OUTBYTES) {
+		return -1;
+	}
+
+	for (i = 0; i < count; ++i) {
+		if (NULL == out[i] || (NULL == in[i] && inlen > 0)) {
+			return -1;
+		}
+	}
+
+	i = 0;
+	if (blake2b_8way != NULL) {
+		for (; i + 8 <= count; i += 8) {
+			blake2b_8way(out + i, outlen, in + i, inlen);
+		}
+	}
+	if (blake2b_4way != NULL) {
+		for (; i + 4 <= count; i += 4) {
+			blake2b_4way(out + i, outlen, in + i, inlen);
+		}
+	}
+	for (; i < count; ++i) {
+		if (blake2b(out[i], outlen, in[i], inlen, NULL, 0) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
@@ -0,0 +1,224 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "blake2.h"
+
+//AVX2 Blake2b: a single-message compression function that keeps one row
+//of the 4x4 state in each register (the layout used by the upstream BLAKE2
+//SIMD code) and a 4-way function that hashes 4 equal-length messages
+//with the same state word of every message in one register.
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#include "blake2-impl.h"
+
+static void blake2b_compress_avx2(blake2b_state *S, const uint8_t *block);
+static void blake2b_4way_avx2(void *const out[], size_t outlen, const void *const in[], size_t inlen);
+
+#endif
+
+blake2b_compress_impl *randomx_blake2b_compress_avx2(void) {
+#if defined(__AVX2__)
+	return &blake2b_compress_avx2;
+#endif
+	return NULL;
+}
+
+blake2b_multi_impl *randomx_blake2b_4way_avx2(void) {
+#if defined(__AVX2__)
+	return &blake2b_4way_avx2;
+#endif
+	return NULL;
+}
+
+#if defined(__AVX2__)
+
+static const uint64_t blake2b_IV[8] = {
+	UINT64_C(0x6a09e667f3bcc908), UINT64_C(0xbb67ae8584caa73b),
+	UINT64_C(0x3c6ef372fe94f82b), UINT64_C(0xa54ff53a5f1d36f1),
+	UINT64_C(0x510e527fade682d1), UINT64_C(0x9b05688c2b3e6c1f),
+	UINT64_C(0x1f83d9abfb41bd6b), UINT64_C(0x5be0cd19137e2179) };
+
+static const uint8_t blake2b_sigma[12][16] = {
+	{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+	{14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+	{11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+	{7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+	{9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+	{2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+	{12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+	{13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+	{6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+	{10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+	{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+	{14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+#define ROTR32(x) _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x) _mm256_shuffle_epi8(x, r24)
+#define ROTR16(x) _mm256_shuffle_epi8(x, r16)
+#define ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+#define G_AVX2(a, b, c, d, x, y)                                               \
+    do {                                                                       \
+        a = _mm256_add_epi64(a, _mm256_add_epi64(b, x));                       \
+        d = ROTR32(_mm256_xor_si256(d, a));                                    \
+        c = _mm256_add_epi64(c, d);                                            \
+        b = ROTR24(_mm256_xor_si256(b, c));                                    \
+        a = _mm256_add_epi64(a, _mm256_add_epi64(b, y));                       \
+        d = ROTR16(_mm256_xor_si256(d, a));                                    \
+        c = _mm256_add_epi64(c, d);                                            \
+        b = ROTR63(_mm256_xor_si256(b, c));                                    \
+    } while ((void)0, 0)
+
+static void blake2b_compress_avx2(blake2b_state *S, const uint8_t *block) {
+	const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+	uint64_t m[16];
+	unsigned int i, r;
+
+	for (i = 0; i < 16; ++i) {
+		m[i] = load64(block + i * sizeof(m[i]));
+	}
+
+	const __m256i h0 = _mm256_loadu_si256((const __m256i*)&S->h[0]);
+	const __m256i h1 = _mm256_loadu_si256((const __m256i*)&S->h[4]);
+	__m256i a = h0;
+	__m256i b = h1;
+	__m256i c = _mm256_loadu_si256((const __m256i*)&blake2b_IV[0]);
+	__m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&blake2b_IV[4]),
+		_mm256_setr_epi64x(S->t[0], S->t[1], S->f[0], S->f[1]));
+
+	for (r = 0; r < 12; ++r) {
+		const uint8_t *s = blake2b_sigma[r];
+		/* columns */
+		G_AVX2(a, b, c, d,
+			_mm256_setr_epi64x(m[s[0]], m[s[2]], m[s[4]], m[s[6]]),
+			_mm256_setr_epi64x(m[s[1]], m[s[3]], m[s[5]], m[s[7]]));
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+		c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+		d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+		/* diagonals */
+		G_AVX2(a, b, c, d,
+			_mm256_setr_epi64x(m[s[8]], m[s[10]], m[s[12]], m[s[14]]),
+			_mm256_setr_epi64x(m[s[9]], m[s[11]], m[s[13]], m[s[15]]));
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+		c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+		d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+	}
+
+	_mm256_storeu_si256((__m256i*)&S->h[0], _mm256_xor_si256(h0, _mm256_xor_si256(a, c)));
+	_mm256_storeu_si256((__m256i*)&S->h[4], _mm256_xor_si256(h1, _mm256_xor_si256(b, d)));
+}
+
+static void blake2b_4way_compress(__m256i h[8], __m256i addr, uint64_t t, uint64_t f) {
+	const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+	const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+	__m256i m[16];
+	__m256i v[16];
+	unsigned int i, r;
+
+	for (i = 0; i < 16; ++i) {
+		m[i] = _mm256_i64gather_epi64((const long long*)0, _mm256_add_epi64(addr, _mm256_set1_epi64x(8 * i)), 1);
+	}
+	for (i = 0; i < 8; ++i) {
+		v[i] = h[i];
+		v[i + 8] = _mm256_set1_epi64x(blake2b_IV[i]);
+	}
+	v[12] = _mm256_xor_si256(v[12], _mm256_set1_epi64x(t));
+	v[14] = _mm256_xor_si256(v[14], _mm256_set1_epi64x(f));
+
+	for (r = 0; r < 12; ++r) {
+		const uint8_t *s = blake2b_sigma[r];
+		G_AVX2(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+		G_AVX2(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+		G_AVX2(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+		G_AVX2(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+		G_AVX2(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+		G_AVX2(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+		G_AVX2(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+		G_AVX2(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+	}
+
+	for (i = 0; i < 8; ++i) {
+		h[i] = _mm256_xor_si256(h[i], _mm256_xor_si256(v[i], v[i + 8]));
+	}
+}
+
+static FORCE_INLINE __m256i lane_addresses(const void *const p[4], uint64_t offset) {
+	return _mm256_add_epi64(_mm256_setr_epi64x((uintptr_t)p[0], (uintptr_t)p[1], (uintptr_t)p[2], (uintptr_t)p[3]),
+		_mm256_set1_epi64x(offset));
+}
+
+static void blake2b_4way_avx2(void *const out[], size_t outlen, const void *const in[], size_t inlen) {
+	uint8_t last[4][BLAKE2B_BLOCKBYTES];
+	const void *lastPtr[4];
+	uint64_t hash[8][4];
+	__m256i h[8];
+	uint64_t t = 0;
+	unsigned int i, k;
+
+	for (i = 0; i < 8; ++i) {
+		h[i] = _mm256_set1_epi64x(blake2b_IV[i]);
+	}
+	/* unkeyed parameter block: digest_length, fanout = 1, depth = 1 */
+	h[0] = _mm256_xor_si256(h[0], _mm256_set1_epi64x(0x01010000 ^ (uint64_t)outlen));
+
+	while (inlen > BLAKE2B_BLOCKBYTES) {
+		blake2b_4way_compress(h, lane_addresses(in, t), t + BLAKE2B_BLOCKBYTES, 0);
+		t += BLAKE2B_BLOCKBYTES;
+		inlen -= BLAKE2B_BLOCKBYTES;
+	}
+	for (k = 0; k < 4; ++k) {
+		if (inlen > 0) {
+			memcpy(last[k], (const uint8_t*)in[k] + t, inlen);
+		}
+		memset(last[k] + inlen, 0, BLAKE2B_BLOCKBYTES - inlen);
+		lastPtr[k] = last[k];
+	}
+	t += inlen;
+	blake2b_4way_compress(h, lane_addresses(lastPtr, 0), t, (uint64_t)-1);
+
+	for (i = 0; i < 8; ++i) {
+		_mm256_storeu_si256((__m256i*)hash[i], h[i]);
+	}
+	for (k = 0; k < 4; ++k) {
+		uint8_t buffer[BLAKE2B_OUTBYTES];
+		for (i = 0; i < 8; ++i) {
+			store64(buffer + sizeof(uint64_t) * i, hash[i][k]);
+		}
+		memcpy(out[k], buffer, outlen);
+	}
+}
+
+#endif
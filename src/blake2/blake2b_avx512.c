@@ -0,0 +1,167 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "blake2.h"
+
+//AVX-512 8-way Blake2b: hashes 8 equal-length messages with the same state
+//word of every message in one 512-bit register.
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+#include "blake2-impl.h"
+
+static void blake2b_8way_avx512(void *const out[], size_t outlen, const void *const in[], size_t inlen);
+
+#endif
+
+blake2b_multi_impl *randomx_blake2b_8way_avx512(void) {
+#if defined(__AVX512F__)
+	return &blake2b_8way_avx512;
+#endif
+	return NULL;
+}
+
+#if defined(__AVX512F__)
+
+static const uint64_t blake2b_IV[8] = {
+	UINT64_C(0x6a09e667f3bcc908), UINT64_C(0xbb67ae8584caa73b),
+	UINT64_C(0x3c6ef372fe94f82b), UINT64_C(0xa54ff53a5f1d36f1),
+	UINT64_C(0x510e527fade682d1), UINT64_C(0x9b05688c2b3e6c1f),
+	UINT64_C(0x1f83d9abfb41bd6b), UINT64_C(0x5be0cd19137e2179) };
+
+static const uint8_t blake2b_sigma[12][16] = {
+	{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+	{14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+	{11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+	{7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+	{9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+	{2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+	{12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+	{13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+	{6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+	{10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+	{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+	{14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+#define G_AVX512(a, b, c, d, x, y)                                             \
+    do {                                                                       \
+        a = _mm512_add_epi64(a, _mm512_add_epi64(b, x));                       \
+        d = _mm512_ror_epi64(_mm512_xor_si512(d, a), 32);                      \
+        c = _mm512_add_epi64(c, d);                                            \
+        b = _mm512_ror_epi64(_mm512_xor_si512(b, c), 24);                      \
+        a = _mm512_add_epi64(a, _mm512_add_epi64(b, y));                       \
+        d = _mm512_ror_epi64(_mm512_xor_si512(d, a), 16);                      \
+        c = _mm512_add_epi64(c, d);                                            \
+        b = _mm512_ror_epi64(_mm512_xor_si512(b, c), 63);                      \
+    } while ((void)0, 0)
+
+static void blake2b_8way_compress(__m512i h[8], __m512i addr, uint64_t t, uint64_t f) {
+	__m512i m[16];
+	__m512i v[16];
+	unsigned int i, r;
+
+	for (i = 0; i < 16; ++i) {
+		m[i] = _mm512_i64gather_epi64(_mm512_add_epi64(addr, _mm512_set1_epi64(8 * i)), (const void*)0, 1);
+	}
+	for (i = 0; i < 8; ++i) {
+		v[i] = h[i];
+		v[i + 8] = _mm512_set1_epi64(blake2b_IV[i]);
+	}
+	v[12] = _mm512_xor_si512(v[12], _mm512_set1_epi64(t));
+	v[14] = _mm512_xor_si512(v[14], _mm512_set1_epi64(f));
+
+	for (r = 0; r < 12; ++r) {
+		const uint8_t *s = blake2b_sigma[r];
+		G_AVX512(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+		G_AVX512(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+		G_AVX512(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+		G_AVX512(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+		G_AVX512(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+		G_AVX512(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+		G_AVX512(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+		G_AVX512(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+	}
+
+	for (i = 0; i < 8; ++i) {
+		h[i] = _mm512_xor_si512(h[i], _mm512_xor_si512(v[i], v[i + 8]));
+	}
+}
+
+static FORCE_INLINE __m512i lane_addresses(const void *const p[8], uint64_t offset) {
+	return _mm512_add_epi64(_mm512_set_epi64((uintptr_t)p[7], (uintptr_t)p[6], (uintptr_t)p[5], (uintptr_t)p[4],
+		(uintptr_t)p[3], (uintptr_t)p[2], (uintptr_t)p[1], (uintptr_t)p[0]), _mm512_set1_epi64(offset));
+}
+
+static void blake2b_8way_avx512(void *const out[], size_t outlen, const void *const in[], size_t inlen) {
+	uint8_t last[8][BLAKE2B_BLOCKBYTES];
+	const void *lastPtr[8];
+	uint64_t hash[8][8];
+	__m512i h[8];
+	uint64_t t = 0;
+	unsigned int i, k;
+
+	for (i = 0; i < 8; ++i) {
+		h[i] = _mm512_set1_epi64(blake2b_IV[i]);
+	}
+	/* unkeyed parameter block: digest_length, fanout = 1, depth = 1 */
+	h[0] = _mm512_xor_si512(h[0], _mm512_set1_epi64(0x01010000 ^ (uint64_t)outlen));
+
+	while (inlen > BLAKE2B_BLOCKBYTES) {
+		blake2b_8way_compress(h, lane_addresses(in, t), t + BLAKE2B_BLOCKBYTES, 0);
+		t += BLAKE2B_BLOCKBYTES;
+		inlen -= BLAKE2B_BLOCKBYTES;
+	}
+	for (k = 0; k < 8; ++k) {
+		if (inlen > 0) {
+			memcpy(last[k], (const uint8_t*)in[k] + t, inlen);
+		}
+		memset(last[k] + inlen, 0, BLAKE2B_BLOCKBYTES - inlen);
+		lastPtr[k] = last[k];
+	}
+	t += inlen;
+	blake2b_8way_compress(h, lane_addresses(lastPtr, 0), t, (uint64_t)-1);
+
+	for (i = 0; i < 8; ++i) {
+		_mm512_storeu_si512((void*)hash[i], h[i]);
+	}
+	for (k = 0; k < 8; ++k) {
+		uint8_t buffer[BLAKE2B_OUTBYTES];
+		for (i = 0; i < 8; ++i) {
+			store64(buffer + sizeof(uint64_t) * i, hash[i][k]);
+		}
+		memcpy(out[k], buffer, outlen);
+	}
+}
+
+#endif
@@ -78,6 +78,358 @@ namespace randomx {
 		}
 	}
 
+#ifdef RANDOMX_THREADED_INTERPRETER
+
+	//Handlers of the threaded interpreter. Instructions with an immediate source operand (_I)
+	//and memory operands with a fixed L3 address (_MZ) get their own handlers.
+#define THREADED_HANDLERS(X) \
+	X(IADD_RS) \
+	X(IADD_M) X(IADD_MZ) \
+	X(ISUB_R) X(ISUB_I) \
+	X(ISUB_M) X(ISUB_MZ) \
+	X(IMUL_R) X(IMUL_I) \
+	X(IMUL_M) X(IMUL_MZ) \
+	X(IMULH_R) \
+	X(IMULH_M) X(IMULH_MZ) \
+	X(ISMULH_R) \
+	X(ISMULH_M) X(ISMULH_MZ) \
+	X(INEG_R) \
+	X(IXOR_R) X(IXOR_I) \
+	X(IXOR_M) X(IXOR_MZ) \
+	X(IROR_R) X(IROR_I) \
+	X(IROL_R) X(IROL_I) \
+	X(ISWAP_R) \
+	X(FSWAP_R) \
+	X(FADD_R) \
+	X(FADD_M) \
+	X(FSUB_R) \
+	X(FSUB_M) \
+	X(FSCAL_R) \
+	X(FMUL_R) \
+	X(FDIV_M) \
+	X(FSQRT_R) \
+	X(CBRANCH) \
+	X(CFROUND) \
+	X(ISTORE) \
+	X(NOP) \
+	X(END)
+
+	//Superinstructions. Any adjacent pair of the most frequent instructions (RANDOMX_FREQ >= 15
+	//in configuration.h) is executed by a single handler. An integer scratchpad load followed
+	//by another operation on the same register is chained, keeping the value in a local.
+#define FUSED_PAIRS(X) \
+	FUSED_PAIR_OPS(X, IADD_RS) \
+	FUSED_PAIR_OPS(X, ISUB_R) \
+	FUSED_PAIR_OPS(X, IMUL_R) \
+	FUSED_PAIR_OPS(X, IXOR_R) \
+	FUSED_PAIR_OPS(X, FADD_R) \
+	FUSED_PAIR_OPS(X, FSUB_R) \
+	FUSED_PAIR_OPS(X, FMUL_R) \
+	FUSED_PAIR_OPS(X, ISTORE)
+
+#define FUSED_PAIR_OPS(X, a) \
+	X(a, IADD_RS) X(a, ISUB_R) X(a, IMUL_R) X(a, IXOR_R) \
+	X(a, FADD_R) X(a, FSUB_R) X(a, FMUL_R) X(a, ISTORE)
+
+#define FUSED_CHAINS(X) \
+	FUSED_CHAIN_OPS(X, IADD_M) \
+	FUSED_CHAIN_OPS(X, ISUB_M) \
+	FUSED_CHAIN_OPS(X, IMUL_M) \
+	FUSED_CHAIN_OPS(X, IXOR_M)
+
+#define FUSED_CHAIN_OPS(X, a) \
+	X(a, IADD_RS) X(a, ISUB_R) X(a, IMUL_R) X(a, IXOR_R) X(a, IROR_R)
+
+#define THREADED_ENUM(x) THR_ ## x,
+#define THREADED_LABEL(x) &&thr_ ## x,
+#define FUSED_PAIR_ENUM(a, b) THR_PAIR_ ## a ## _ ## b,
+#define FUSED_PAIR_LABEL(a, b) &&thr_PAIR_ ## a ## _ ## b,
+#define FUSED_CHAIN_ENUM(a, b) THR_CHAIN_ ## a ## _ ## b,
+#define FUSED_CHAIN_LABEL(a, b) &&thr_CHAIN_ ## a ## _ ## b,
+#define FUSED_COUNT(a, b) + 1
+#define FUSED_POSITION(a, b) if (type == InstructionType::b) return position; ++position;
+
+	enum ThreadedHandler {
+		THREADED_HANDLERS(THREADED_ENUM)
+		FUSED_PAIRS(FUSED_PAIR_ENUM)
+		FUSED_CHAINS(FUSED_CHAIN_ENUM)
+	};
+
+	constexpr int FusedPairOps = 0 FUSED_PAIR_OPS(FUSED_COUNT, _);
+	constexpr int FusedChainOps = 0 FUSED_CHAIN_OPS(FUSED_COUNT, _);
+
+	static int fusedPairPosition(InstructionType type) {
+		int position = 0;
+		FUSED_PAIR_OPS(FUSED_POSITION, _)
+		return -1;
+	}
+
+	static int fusedChainPosition(InstructionType type) {
+		int position = 0;
+		FUSED_CHAIN_OPS(FUSED_POSITION, _)
+		return -1;
+	}
+
+	static int fusedLoadPosition(InstructionType type) {
+		switch (type)
+		{
+		case InstructionType::IADD_M:
+			return 0;
+		case InstructionType::ISUB_M:
+			return 1;
+		case InstructionType::IMUL_M:
+			return 2;
+		case InstructionType::IXOR_M:
+			return 3;
+		default:
+			return -1;
+		}
+	}
+
+	static int fusedHandler(const InstructionByteCode& first, const InstructionByteCode& second) {
+		int load = fusedLoadPosition(first.type);
+		int chain = fusedChainPosition(second.type);
+		//IADD_RS may read the destination register as its source
+		if (load >= 0 && chain >= 0 && first.idst == second.idst && second.isrc != second.idst) {
+			return THR_CHAIN_IADD_M_IADD_RS + load * FusedChainOps + chain;
+		}
+		int pairFirst = fusedPairPosition(first.type);
+		int pairSecond = fusedPairPosition(second.type);
+		if (pairFirst >= 0 && pairSecond >= 0) {
+			return THR_PAIR_IADD_RS_IADD_RS + pairFirst * FusedPairOps + pairSecond;
+		}
+		return -1;
+	}
+
+#define THREADED_CASE(x) case InstructionType::x: \
+	handler = THR_ ## x; \
+	break;
+
+#define THREADED_SPECIAL_CASE(x, cond, y) case InstructionType::x: \
+	handler = (cond) ? THR_ ## y : THR_ ## x; \
+	break;
+
+	void BytecodeMachine::threadBytecode(InstructionByteCode bytecode[BytecodeSize]) {
+		const void* const* handlers;
+		executeThreaded(nullptr, nullptr, nullptr, &handlers);
+		for (unsigned i = 0; i < RANDOMX_PROGRAM_SIZE; ++i) {
+			auto& ibc = bytecode[i];
+			bool imm = ibc.isrc == &ibc.imm;
+			bool l3 = ibc.isrc == &zero;
+			ThreadedHandler handler;
+			switch (ibc.type)
+			{
+				THREADED_SPECIAL_CASE(IADD_M, l3, IADD_MZ)
+				THREADED_SPECIAL_CASE(ISUB_R, imm, ISUB_I)
+				THREADED_SPECIAL_CASE(ISUB_M, l3, ISUB_MZ)
+				THREADED_SPECIAL_CASE(IMUL_R, imm, IMUL_I)
+				THREADED_SPECIAL_CASE(IMUL_M, l3, IMUL_MZ)
+				THREADED_SPECIAL_CASE(IMULH_M, l3, IMULH_MZ)
+				THREADED_SPECIAL_CASE(ISMULH_M, l3, ISMULH_MZ)
+				THREADED_SPECIAL_CASE(IXOR_R, imm, IXOR_I)
+				THREADED_SPECIAL_CASE(IXOR_M, l3, IXOR_MZ)
+				THREADED_SPECIAL_CASE(IROR_R, imm, IROR_I)
+				THREADED_SPECIAL_CASE(IROL_R, imm, IROL_I)
+				THREADED_CASE(IADD_RS)
+				THREADED_CASE(IMULH_R)
+				THREADED_CASE(ISMULH_R)
+				THREADED_CASE(INEG_R)
+				THREADED_CASE(ISWAP_R)
+				THREADED_CASE(FSWAP_R)
+				THREADED_CASE(FADD_R)
+				THREADED_CASE(FADD_M)
+				THREADED_CASE(FSUB_R)
+				THREADED_CASE(FSUB_M)
+				THREADED_CASE(FSCAL_R)
+				THREADED_CASE(FMUL_R)
+				THREADED_CASE(FDIV_M)
+				THREADED_CASE(FSQRT_R)
+				THREADED_CASE(CBRANCH)
+				THREADED_CASE(CFROUND)
+				THREADED_CASE(ISTORE)
+				THREADED_CASE(NOP)
+
+			case InstructionType::IMUL_RCP: //compiled as IMUL_R
+			default:
+				UNREACHABLE;
+			}
+			ibc.handler = handlers[handler];
+		}
+		bytecode[RANDOMX_PROGRAM_SIZE].handler = handlers[THR_END];
+		//Each entry may be fused with the next one. Entries covered by a fused handler
+		//keep their own handler, so branches into the middle of a pair stay valid.
+		for (unsigned i = 0; i < RANDOMX_PROGRAM_SIZE - 1; ++i) {
+			int handler = fusedHandler(bytecode[i], bytecode[i + 1]);
+			if (handler >= 0) {
+				bytecode[i].handler = handlers[handler];
+			}
+		}
+	}
+
+#define THREADED_DISPATCH() goto *ibc->handler
+#define THREADED_NEXT() ++ibc; THREADED_DISPATCH()
+#define THREADED_EXE(x) thr_ ## x: \
+	exe_ ## x(*ibc, pc, scratchpad, *config); \
+	THREADED_NEXT();
+#define THREADED_L3_ADDRESS (scratchpad + (ibc->imm & ScratchpadL3Mask))
+#define FUSED_PAIR_HANDLER(a, b) thr_PAIR_ ## a ## _ ## b: \
+	exe_ ## a(ibc[0], pc, scratchpad, *config); \
+	exe_ ## b(ibc[1], pc, scratchpad, *config); \
+	FUSED_NEXT();
+#define FUSED_CHAIN_HANDLER(a, b) thr_CHAIN_ ## a ## _ ## b: \
+	{ \
+		int_reg_t value = *ibc[0].idst; \
+		CHAIN_ ## a(value, ibc[0]); \
+		CHAIN_ ## b(value, ibc[1]); \
+		*ibc[0].idst = value; \
+	} \
+	FUSED_NEXT();
+#define FUSED_NEXT() ++saved; ibc += 2; THREADED_DISPATCH()
+#define CHAIN_IADD_M(v, i) v += load64(getScratchpadAddress(i, scratchpad))
+#define CHAIN_ISUB_M(v, i) v -= load64(getScratchpadAddress(i, scratchpad))
+#define CHAIN_IMUL_M(v, i) v *= load64(getScratchpadAddress(i, scratchpad))
+#define CHAIN_IXOR_M(v, i) v ^= load64(getScratchpadAddress(i, scratchpad))
+#define CHAIN_IADD_RS(v, i) v += (*i.isrc << i.shift) + i.imm
+#define CHAIN_ISUB_R(v, i) v -= *i.isrc
+#define CHAIN_IMUL_R(v, i) v *= *i.isrc
+#define CHAIN_IXOR_R(v, i) v ^= *i.isrc
+#define CHAIN_IROR_R(v, i) v = rotr(v, *i.isrc & 63)
+
+	uint32_t BytecodeMachine::executeThreaded(InstructionByteCode* bytecode, uint8_t* scratchpad, ProgramConfiguration* config, const void* const** handlers) {
+		static const void* const handlerTable[] = {
+			THREADED_HANDLERS(THREADED_LABEL)
+			FUSED_PAIRS(FUSED_PAIR_LABEL)
+			FUSED_CHAINS(FUSED_CHAIN_LABEL)
+		};
+		if (handlers != nullptr) {
+			*handlers = handlerTable;
+			return 0;
+		}
+		InstructionByteCode* ibc = bytecode;
+		int pc = 0; //only used by CBRANCH, which has its own handler
+		uint32_t saved = 0;
+		THREADED_DISPATCH();
+
+		THREADED_EXE(IADD_RS)
+		THREADED_EXE(IADD_M)
+	thr_IADD_MZ:
+		*ibc->idst += load64(THREADED_L3_ADDRESS);
+		THREADED_NEXT();
+		THREADED_EXE(ISUB_R)
+	thr_ISUB_I:
+		*ibc->idst -= ibc->imm;
+		THREADED_NEXT();
+		THREADED_EXE(ISUB_M)
+	thr_ISUB_MZ:
+		*ibc->idst -= load64(THREADED_L3_ADDRESS);
+		THREADED_NEXT();
+		THREADED_EXE(IMUL_R)
+	thr_IMUL_I:
+		*ibc->idst *= ibc->imm;
+		THREADED_NEXT();
+		THREADED_EXE(IMUL_M)
+	thr_IMUL_MZ:
+		*ibc->idst *= load64(THREADED_L3_ADDRESS);
+		THREADED_NEXT();
+		THREADED_EXE(IMULH_R)
+		THREADED_EXE(IMULH_M)
+	thr_IMULH_MZ:
+		*ibc->idst = mulh(*ibc->idst, load64(THREADED_L3_ADDRESS));
+		THREADED_NEXT();
+		THREADED_EXE(ISMULH_R)
+		THREADED_EXE(ISMULH_M)
+	thr_ISMULH_MZ:
+		*ibc->idst = smulh(unsigned64ToSigned2sCompl(*ibc->idst), unsigned64ToSigned2sCompl(load64(THREADED_L3_ADDRESS)));
+		THREADED_NEXT();
+		THREADED_EXE(INEG_R)
+		THREADED_EXE(IXOR_R)
+	thr_IXOR_I:
+		*ibc->idst ^= ibc->imm;
+		THREADED_NEXT();
+		THREADED_EXE(IXOR_M)
+	thr_IXOR_MZ:
+		*ibc->idst ^= load64(THREADED_L3_ADDRESS);
+		THREADED_NEXT();
+		THREADED_EXE(IROR_R)
+	thr_IROR_I:
+		*ibc->idst = rotr(*ibc->idst, ibc->imm & 63);
+		THREADED_NEXT();
+		THREADED_EXE(IROL_R)
+	thr_IROL_I:
+		*ibc->idst = rotl(*ibc->idst, ibc->imm & 63);
+		THREADED_NEXT();
+		THREADED_EXE(ISWAP_R)
+		THREADED_EXE(FSWAP_R)
+		THREADED_EXE(FADD_R)
+		THREADED_EXE(FADD_M)
+		THREADED_EXE(FSUB_R)
+		THREADED_EXE(FSUB_M)
+		THREADED_EXE(FSCAL_R)
+		THREADED_EXE(FMUL_R)
+		THREADED_EXE(FDIV_M)
+		THREADED_EXE(FSQRT_R)
+	thr_CBRANCH:
+		*ibc->idst += ibc->imm;
+		if ((*ibc->idst & ibc->memMask) == 0) {
+			ibc = bytecode + (ibc->target + 1);
+			THREADED_DISPATCH();
+		}
+		THREADED_NEXT();
+		THREADED_EXE(CFROUND)
+		THREADED_EXE(ISTORE)
+	thr_NOP:
+		THREADED_NEXT();
+		FUSED_PAIRS(FUSED_PAIR_HANDLER)
+		FUSED_CHAINS(FUSED_CHAIN_HANDLER)
+	thr_END:
+		return saved;
+	}
+
+	uint32_t BytecodeMachine::executeBytecodeThreaded(InstructionByteCode bytecode[BytecodeSize], uint8_t* scratchpad, ProgramConfiguration& config) {
+		return executeThreaded(bytecode, scratchpad, &config, nullptr);
+	}
+
+#undef CHAIN_IROR_R
+#undef CHAIN_IXOR_R
+#undef CHAIN_IMUL_R
+#undef CHAIN_ISUB_R
+#undef CHAIN_IADD_RS
+#undef CHAIN_IXOR_M
+#undef CHAIN_IMUL_M
+#undef CHAIN_ISUB_M
+#undef CHAIN_IADD_M
+#undef FUSED_NEXT
+#undef FUSED_CHAIN_HANDLER
+#undef FUSED_PAIR_HANDLER
+#undef THREADED_L3_ADDRESS
+#undef THREADED_EXE
+#undef THREADED_NEXT
+#undef THREADED_DISPATCH
+#undef THREADED_SPECIAL_CASE
+#undef THREADED_CASE
+#undef FUSED_POSITION
+#undef FUSED_COUNT
+#undef FUSED_CHAIN_LABEL
+#undef FUSED_CHAIN_ENUM
+#undef FUSED_PAIR_LABEL
+#undef FUSED_PAIR_ENUM
+#undef THREADED_LABEL
+#undef THREADED_ENUM
+#undef FUSED_CHAIN_OPS
+#undef FUSED_CHAINS
+#undef FUSED_PAIR_OPS
+#undef FUSED_PAIRS
+#undef THREADED_HANDLERS
+
+#else
+
+	uint32_t BytecodeMachine::executeBytecodeThreaded(InstructionByteCode bytecode[BytecodeSize], uint8_t* scratchpad, ProgramConfiguration& config) {
+		executeBytecode(bytecode, scratchpad, config);
+		return 0;
+	}
+
+#endif
+
 	void BytecodeMachine::compileInstruction(RANDOMX_GEN_ARGS) {
 		int opcode = instr.opcode;
 
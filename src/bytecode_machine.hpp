@@ -33,8 +33,22 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "instruction.hpp"
 #include "program.hpp"
 
+//threaded dispatch relies on the "labels as values" GNU extension
+#if defined(RANDOMX_THREADED_INTERPRETER) && !defined(__GNUC__)
+#undef RANDOMX_THREADED_INTERPRETER
+#endif
+
+#ifdef RANDOMX_THREADED_INTERPRETER
+#define RANDOMX_HAVE_THREADED_INTERPRETER 1
+#else
+#define RANDOMX_HAVE_THREADED_INTERPRETER 0
+#endif
+
 namespace randomx {
 
+	//one extra entry terminates the program in the threaded interpreter
+	constexpr int BytecodeSize = RANDOMX_PROGRAM_SIZE + 1;
+
 	//register file in machine byte order
 	struct NativeRegisterFile {
 		int_reg_t r[RegistersCount] = { 0 };
@@ -62,6 +76,9 @@ namespace randomx {
 			uint16_t shift;
 		};
 		uint32_t memMask;
+#ifdef RANDOMX_THREADED_INTERPRETER
+		const void* handler;
+#endif
 	};
 
 #define OPCODE_CEIL_DECLARE(curr, prev) constexpr int ceil_ ## curr = ceil_ ## prev + RANDOMX_FREQ_ ## curr;
@@ -114,13 +131,16 @@ namespace randomx {
 			nreg = &regFile;
 		}
 
-		void compileProgram(Program& program, InstructionByteCode bytecode[RANDOMX_PROGRAM_SIZE], NativeRegisterFile& regFile) {
+		void compileProgram(Program& program, InstructionByteCode bytecode[BytecodeSize], NativeRegisterFile& regFile) {
 			beginCompilation(regFile);
 			for (unsigned i = 0; i < RANDOMX_PROGRAM_SIZE; ++i) {
 				auto& instr = program(i);
 				auto& ibc = bytecode[i];
 				compileInstruction(instr, i, ibc);
 			}
+#ifdef RANDOMX_THREADED_INTERPRETER
+			threadBytecode(bytecode);
+#endif
 		}
 
 		static void executeBytecode(InstructionByteCode bytecode[RANDOMX_PROGRAM_SIZE], uint8_t* scratchpad, ProgramConfiguration& config) {
@@ -130,6 +150,11 @@ namespace randomx {
 			}
 		}
 
+		//Executes the program by jumping directly from one instruction handler to the next.
+		//Falls back to executeBytecode if threaded dispatch is not available.
+		//Returns the number of dispatches saved by fused instruction pairs.
+		static uint32_t executeBytecodeThreaded(InstructionByteCode bytecode[BytecodeSize], uint8_t* scratchpad, ProgramConfiguration& config);
+
 		void compileInstruction(RANDOMX_GEN_ARGS)
 #ifdef RANDOMX_GEN_TABLE
 		{
@@ -284,6 +309,11 @@ namespace randomx {
 			return scratchpad + addr;
 		}
 
+#ifdef RANDOMX_THREADED_INTERPRETER
+		static void threadBytecode(InstructionByteCode bytecode[BytecodeSize]);
+		static uint32_t executeThreaded(InstructionByteCode* bytecode, uint8_t* scratchpad, ProgramConfiguration* config, const void* const** handlers);
+#endif
+
 #ifdef RANDOMX_GEN_TABLE
 		static InstructionGenBytecode genTable[256];
 
@@ -26,6 +26,12 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include "cpu.hpp"
 
 #if defined(_M_X64) || defined(__x86_64__)
@@ -33,11 +39,21 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 	#ifdef _WIN32
 		#include <intrin.h>
 		#define cpuid(info, x) __cpuidex(info, x, 0)
+		#define cpuidex(info, x, y) __cpuidex(info, x, y)
+		#define xgetbv(x) _xgetbv(x)
 	#else //GCC
 		#include <cpuid.h>
 		void cpuid(int info[4], int InfoType) {
 			__cpuid_count(InfoType, 0, info[0], info[1], info[2], info[3]);
 		}
+		void cpuidex(int info[4], int InfoType, int SubLeaf) {
+			__cpuid_count(InfoType, SubLeaf, info[0], info[1], info[2], info[3]);
+		}
+		static uint64_t xgetbv(uint32_t xcr) {
+			uint32_t eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(xcr));
+			return ((uint64_t)edx << 32) | eax;
+		}
 	#endif
 #endif
 
@@ -48,19 +64,114 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace randomx {
 
-	Cpu::Cpu() : aes_(false), ssse3_(false), avx2_(false) {
+#ifdef __linux__
+	//number of CPUs in a sysfs list such as "0-3,8-11", 0 if the file cannot be read
+	static unsigned readCpuListCount(const std::string& path) {
+		std::ifstream file(path);
+		std::string list;
+		if (!(file >> list))
+			return 0;
+		unsigned count = 0;
+		size_t pos = 0;
+		while (pos < list.size()) {
+			size_t end = list.find(',', pos);
+			if (end == std::string::npos)
+				end = list.size();
+			std::string range = list.substr(pos, end - pos);
+			size_t dash = range.find('-');
+			if (dash == std::string::npos)
+				count += 1;
+			else
+				count += std::stoul(range.substr(dash + 1)) - std::stoul(range.substr(0, dash)) + 1;
+			pos = end + 1;
+		}
+		return count;
+	}
+#endif
+
+	Cpu::Cpu() : brand_(), vendor_(CpuVendorUnknown), family_(0), model_(0), stepping_(0), aes_(false), ssse3_(false), avx2_(false),
+		avx512f_(false), vaes_(false), bmi2_(false), l1dSize_(0), l2Size_(0), l3Size_(0), threadsPerCore_(1), threadsPerL2_(0),
+		threadsPerL3_(0), logicalCpus_(0)
+	{
 #ifdef HAVE_CPUID
 		int info[4];
+		bool osAvx = false, osAvx512 = false;
+		cpuid(info, 0x80000000);
+		if ((unsigned)info[0] >= 0x80000004) {
+			for (int i = 0; i < 3; ++i) {
+				cpuid(info, 0x80000002 + i);
+				memcpy(brand_ + 16 * i, info, sizeof(info));
+			}
+		}
 		cpuid(info, 0);
 		int nIds = info[0];
+		if (info[1] == 0x756e6547) //"Genu"ineIntel
+			vendor_ = CpuVendorIntel;
+		else if (info[1] == 0x68747541 || info[1] == 0x6f677948) //"Auth"enticAMD, "Hygo"nGenuine
+			vendor_ = CpuVendorAmd;
 		if (nIds >= 0x00000001) {
 			cpuid(info, 0x00000001);
 			ssse3_ = (info[2] & (1 << 9)) != 0;
 			aes_ = (info[2] & (1 << 25)) != 0;
+			//register state enabled by the OS: XMM/YMM (bits 1-2), opmask/ZMM (bits 5-7)
+			if ((info[2] & (1 << 27)) != 0) { //OSXSAVE
+				uint64_t xcr0 = xgetbv(0);
+				osAvx = (xcr0 & 0x06) == 0x06;
+				osAvx512 = (xcr0 & 0xe6) == 0xe6;
+			}
+			stepping_ = info[0] & 0xf;
+			model_ = (info[0] >> 4) & 0xf;
+			family_ = (info[0] >> 8) & 0xf;
+			if (family_ == 0xf)
+				family_ += (info[0] >> 20) & 0xff;
+			if (family_ == 0x6 || family_ >= 0xf)
+				model_ += ((info[0] >> 16) & 0xf) << 4;
 		}
 		if (nIds >= 0x00000007) {
 			cpuid(info, 0x00000007);
-			avx2_ = (info[1] & (1 << 5)) != 0;
+			avx2_ = osAvx && (info[1] & (1 << 5)) != 0;
+			avx512f_ = osAvx512 && (info[1] & (1 << 16)) != 0;
+			vaes_ = osAvx && (info[2] & (1 << 9)) != 0;
+			bmi2_ = (info[1] & (1 << 8)) != 0;
+		}
+		if (nIds >= 0x0000000b) {
+			cpuidex(info, 0x0000000b, 0);
+			if (((info[2] >> 8) & 0xff) == 1 && (info[1] & 0xffff) != 0) //SMT level
+				threadsPerCore_ = info[1] & 0xffff;
+		}
+		//deterministic cache parameters: leaf 4 (Intel), leaf 0x8000001D (AMD topology extensions)
+		int cacheLeaf = 0;
+		if (vendor_ == CpuVendorIntel && nIds >= 0x00000004) {
+			cacheLeaf = 0x00000004;
+		}
+		else if (vendor_ == CpuVendorAmd) {
+			cpuid(info, 0x80000000);
+			int nExIds = info[0];
+			cpuid(info, 0x80000001);
+			if ((unsigned)nExIds >= 0x8000001d && (info[2] & (1 << 22)) != 0)
+				cacheLeaf = 0x8000001d;
+		}
+		for (int i = 0; cacheLeaf != 0 && i < 16; ++i) {
+			cpuidex(info, cacheLeaf, i);
+			int type = info[0] & 0x1f;
+			if (type == 0)
+				break;
+			if (type == 2) //instruction cache
+				continue;
+			int level = (info[0] >> 5) & 0x7;
+			unsigned sharing = ((info[0] >> 14) & 0xfff) + 1;
+			uint32_t size = (((unsigned)info[1] >> 22) + 1) * (((info[1] >> 12) & 0x3ff) + 1) * ((info[1] & 0xfff) + 1) * ((unsigned)info[2] + 1);
+			if (level == 1) {
+				l1dSize_ = size;
+			}
+			else if (level == 2) {
+				l2Size_ = size;
+				threadsPerL2_ = sharing;
+			}
+			else if (level == 3) {
+				l3Size_ = size;
+				threadsPerL3_ = sharing;
+			}
 		}
 #elif defined(__aarch64__)
 	#if defined(HWCAP_AES)
@@ -71,6 +182,58 @@ namespace randomx {
 	#endif
 #endif
 		//TODO POWER8 AES
+		readCacheTopology();
+	}
+
+	//the OS view of the caches is more accurate than the CPUID limits (disabled cores, VMs)
+	void Cpu::readCacheTopology() {
+		logicalCpus_ = std::thread::hardware_concurrency();
+#ifdef __linux__
+		try {
+			const std::string base = "/sys/devices/system/cpu/cpu0/";
+			unsigned siblings = readCpuListCount(base + "topology/thread_siblings_list");
+			if (siblings != 0)
+				threadsPerCore_ = siblings;
+			for (int i = 0; i < 16; ++i) {
+				const std::string index = base + "cache/index" + std::to_string(i) + "/";
+				std::ifstream levelFile(index + "level"), typeFile(index + "type"), sizeFile(index + "size");
+				int level;
+				std::string type, size;
+				if (!(levelFile >> level) || !(typeFile >> type) || !(sizeFile >> size))
+					break;
+				if (type == "Instruction" || size.empty())
+					continue;
+				uint32_t bytes = std::stoul(size);
+				if (size.back() == 'K')
+					bytes <<= 10;
+				else if (size.back() == 'M')
+					bytes <<= 20;
+				unsigned sharing = readCpuListCount(index + "shared_cpu_list");
+				if (level == 1) {
+					l1dSize_ = bytes;
+				}
+				else if (level == 2) {
+					l2Size_ = bytes;
+					threadsPerL2_ = sharing;
+				}
+				else if (level == 3) {
+					l3Size_ = bytes;
+					threadsPerL3_ = sharing;
+				}
+			}
+		}
+		catch (std::exception&) {
+			//malformed sysfs entry: keep the CPUID values
+		}
+#endif
+		if (logicalCpus_ != 0) {
+			if (threadsPerCore_ > logicalCpus_)
+				threadsPerCore_ = logicalCpus_;
+			if (threadsPerL2_ > logicalCpus_)
+				threadsPerL2_ = logicalCpus_;
+			if (threadsPerL3_ > logicalCpus_)
+				threadsPerL3_ = logicalCpus_;
+		}
 	}
 
 }
@@ -28,11 +28,22 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <cstdint>
+
 namespace randomx {
 
+	enum CpuVendor {
+		CpuVendorUnknown,
+		CpuVendorIntel,
+		CpuVendorAmd,
+	};
+
 	class Cpu {
 	public:
 		Cpu();
+		CpuVendor vendor() const {
+			return vendor_;
+		}
 		bool hasAes() const {
 			return aes_;
 		}
@@ -42,8 +53,59 @@ namespace randomx {
 		bool hasAvx2() const {
 			return avx2_;
 		}
+		bool hasAvx512() const {
+			return avx512f_;
+		}
+		bool hasVaes() const {
+			return vaes_;
+		}
+		bool hasBmi2() const {
+			return bmi2_;
+		}
+		unsigned family() const {
+			return family_;
+		}
+		unsigned model() const {
+			return model_;
+		}
+		unsigned stepping() const {
+			return stepping_;
+		}
+		//processor brand string, empty if the CPU does not report one
+		const char* brand() const {
+			return brand_;
+		}
+		//cache sizes in bytes, 0 if unknown
+		uint32_t l1dSize() const {
+			return l1dSize_;
+		}
+		uint32_t l2Size() const {
+			return l2Size_;
+		}
+		uint32_t l3Size() const {
+			return l3Size_;
+		}
+		//number of logical CPUs sharing one core, one L2 or one L3 cache
+		unsigned threadsPerCore() const {
+			return threadsPerCore_;
+		}
+		unsigned threadsPerL2() const {
+			return threadsPerL2_;
+		}
+		unsigned threadsPerL3() const {
+			return threadsPerL3_;
+		}
+		unsigned logicalCpus() const {
+			return logicalCpus_;
+		}
 	private:
-		bool aes_, ssse3_, avx2_;
+		void readCacheTopology();
+		char brand_[49];
+		CpuVendor vendor_;
+		unsigned family_, model_, stepping_;
+		bool aes_, ssse3_, avx2_, avx512f_, vaes_, bmi2_;
+		uint32_t l1dSize_, l2Size_, l3Size_;
+		unsigned threadsPerCore_, threadsPerL2_, threadsPerL3_, logicalCpus_;
 	};
 
 }
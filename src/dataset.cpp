@@ -39,6 +39,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <limits>
 #include <cstring>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <exception>
+#include <system_error>
 
 #include "common.hpp"
 #include "dataset.hpp"
@@ -51,6 +57,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "argon2_core.h"
 #include "jit_compiler.hpp"
 #include "intrin_portable.h"
+#include "blake2/blake2.h"
 
 static_assert(RANDOMX_ARGON_MEMORY % (RANDOMX_ARGON_LANES * ARGON2_SYNC_POINTS) == 0, "RANDOMX_ARGON_MEMORY - invalid value");
 static_assert(ARGON2_BLOCK_SIZE == randomx::ArgonBlockSize, "Unpexpected value of ARGON2_BLOCK_SIZE");
@@ -68,7 +75,42 @@ namespace randomx {
 	template void deallocCache<DefaultAllocator>(randomx_cache* cache);
 	template void deallocCache<LargePageAllocator>(randomx_cache* cache);
 
-	void initCache(randomx_cache* cache, const void* key, size_t keySize) {
+	void fillMemoryBlocks(argon2_instance_t* instance) {
+		if (instance->threads <= 1 || instance->lanes <= 1) {
+			randomx_argon2_fill_memory_blocks(instance);
+			return;
+		}
+		//segments of different lanes in the same slice are independent, so lanes
+		//are handed out to the threads and all of them are joined at each sync point
+		std::vector<std::thread> workers;
+		workers.reserve(instance->threads - 1);
+		for (uint32_t r = 0; r < instance->passes; ++r) {
+			for (uint32_t s = 0; s < ARGON2_SYNC_POINTS; ++s) {
+				std::atomic<uint32_t> nextLane(0);
+				auto fillLanes = [&]() {
+					uint32_t l;
+					while ((l = nextLane.fetch_add(1)) < instance->lanes) {
+						argon2_position_t position = { r, l, (uint8_t)s, 0 };
+						instance->impl(instance, position);
+					}
+				};
+				for (uint32_t t = 1; t < instance->threads; ++t) {
+					try {
+						workers.push_back(std::thread(fillLanes));
+					}
+					catch (const std::system_error&) {
+						break; //the remaining lanes are filled by the running threads
+					}
+				}
+				fillLanes();
+				for (auto& worker : workers)
+					worker.join();
+				workers.clear();
+			}
+		}
+	}
+
+	static void fillCache(randomx_cache* cache, const void* key, size_t keySize) {
 		uint32_t memory_blocks, segment_length;
 		argon2_instance_t instance;
 		argon2_context context;
@@ -86,7 +128,12 @@ namespace randomx {
 		context.t_cost = RANDOMX_ARGON_ITERATIONS;
 		context.m_cost = RANDOMX_ARGON_MEMORY;
 		context.lanes = RANDOMX_ARGON_LANES;
-		context.threads = 1;
+		context.threads = cache->initThreads;
+		if (context.threads == 0) {
+			static const unsigned hardwareThreads = std::thread::hardware_concurrency();
+			context.threads = std::max(1u, std::min<unsigned>(RANDOMX_ARGON_LANES, hardwareThreads));
+		}
+		context.threads = std::min<uint32_t>(context.threads, ARGON2_MAX_THREADS);
 		context.allocate_cbk = NULL;
 		context.free_cbk = NULL;
 		context.flags = ARGON2_DEFAULT_FLAGS;
@@ -122,8 +169,10 @@ namespace randomx {
 		 */
 		randomx_argon2_initialize(&instance, &context);
 
-		randomx_argon2_fill_memory_blocks(&instance);
+		fillMemoryBlocks(&instance);
+	}
 
+	static void generateSuperscalarPrograms(randomx_cache* cache, const void* key, size_t keySize) {
 		cache->reciprocalCache.clear();
 		randomx::Blake2Generator gen(key, keySize);
 		for (int i = 0; i < RANDOMX_CACHE_ACCESSES; ++i) {
@@ -136,17 +185,58 @@ namespace randomx {
 					cache->reciprocalCache.push_back(rcp);
 				}
 			}
+			randomx::compileSuperscalarBytecode(cache->programs[i], cache->superscalarBytecode[i], &cache->reciprocalCache);
 		}
 	}
 
-	void initCacheCompile(randomx_cache* cache, const void* key, size_t keySize) {
-		initCache(cache, key, keySize);
+	static void compileSuperscalarHash(randomx_cache* cache) {
 		cache->jit->enableWriting();
 		cache->jit->generateSuperscalarHash(cache->programs, cache->reciprocalCache);
 		cache->jit->generateDatasetInitCode();
 		cache->jit->enableExecution();
 	}
 
+	//The superscalar programs depend only on the key, not on the cache memory,
+	//so they are generated (and compiled) on a helper thread while Argon2 fills.
+	static void initCacheOverlapped(randomx_cache* cache, const void* key, size_t keySize, bool compile) {
+		std::exception_ptr error;
+		auto generate = [&]() {
+			try {
+				generateSuperscalarPrograms(cache, key, keySize);
+				if (compile)
+					compileSuperscalarHash(cache);
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+		};
+		static const unsigned hardwareThreads = std::thread::hardware_concurrency();
+		std::thread helper;
+		if (hardwareThreads != 1) {
+			try {
+				helper = std::thread(generate);
+			}
+			catch (const std::system_error&) {
+				//run serially below
+			}
+		}
+		fillCache(cache, key, keySize);
+		if (helper.joinable())
+			helper.join();
+		else
+			generate();
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void initCache(randomx_cache* cache, const void* key, size_t keySize) {
+		initCacheOverlapped(cache, key, keySize, false);
+	}
+
+	void initCacheCompile(randomx_cache* cache, const void* key, size_t keySize) {
+		initCacheOverlapped(cache, key, keySize, true);
+	}
+
 	constexpr uint64_t superscalarMul0 = 6364136223846793005ULL;
 	constexpr uint64_t superscalarAdd1 = 9298411001130361340ULL;
 	constexpr uint64_t superscalarAdd2 = 12065312585734608966ULL;
@@ -178,7 +268,7 @@ namespace randomx {
 			rx_prefetch_nta(mixBlock);
 			SuperscalarProgram& prog = cache->programs[i];
 
-			executeSuperscalar(rl, prog, &cache->reciprocalCache);
+			executeSuperscalarBytecode(rl, cache->superscalarBytecode[i].data());
 
 			for (unsigned q = 0; q < 8; ++q)
 				rl[q] ^= load64_native(mixBlock + 8 * q);
@@ -193,4 +283,108 @@ namespace randomx {
 		for (uint32_t itemNumber = startItem; itemNumber < endItem; ++itemNumber, dataset += CacheLineSize)
 			initDatasetItem(cache, dataset, itemNumber);
 	}
+
+	constexpr size_t SharedDatasetAlignment = 2 * 1024 * 1024;
+	//the header takes a whole huge page so that the dataset stays huge page aligned
+	constexpr size_t SharedDatasetHeaderSize = SharedDatasetAlignment;
+	constexpr size_t SharedDatasetMapSize = SharedDatasetHeaderSize + alignSize(DatasetSize, SharedDatasetAlignment);
+
+	//a new shared memory object is zero-filled, which is a valid empty header.
+	//Processes synchronize with two locks on the object: the fill lock is held
+	//exclusively by the process writing the dataset, the reader lock is held shared by
+	//every process using the current contents and exclusively while they are rewritten.
+	struct SharedDatasetHeader {
+		std::atomic<uint64_t> magic; //format and RandomX configuration
+		std::atomic<uint64_t> generation; //incremented whenever the dataset is rewritten
+		std::atomic<uint64_t> ready; //1 if the dataset holds the items for seedTag
+		uint8_t seedTag[32];
+	};
+
+	static_assert(sizeof(SharedDatasetHeader) <= SharedDatasetHeaderSize, "SharedDatasetHeader is too big");
+
+	enum SharedDatasetLock {
+		SharedDatasetFillLock = 0,
+		SharedDatasetReaderLock = 1,
+	};
+
+	//processes built with different parameters must not attach to the same dataset
+	static uint64_t sharedDatasetMagic() {
+		const std::string config = std::string("RXDS2 ") + RANDOMX_ARGON_SALT
+			+ " " + std::to_string(RANDOMX_ARGON_MEMORY) + " " + std::to_string(RANDOMX_ARGON_ITERATIONS)
+			+ " " + std::to_string(RANDOMX_ARGON_LANES) + " " + std::to_string(RANDOMX_CACHE_ACCESSES)
+			+ " " + std::to_string(RANDOMX_SUPERSCALAR_LATENCY) + " " + std::to_string(RANDOMX_DATASET_BASE_SIZE)
+			+ " " + std::to_string(RANDOMX_DATASET_EXTRA_SIZE) + " " + std::to_string(RANDOMX_DATASET_ITEM_SIZE);
+		uint64_t magic;
+		blake2b(&magic, sizeof(magic), config.data(), config.size(), nullptr, 0);
+		return magic != 0 ? magic : 1;
+	}
+
+	void allocSharedDataset(randomx_dataset* dataset, const char* name, bool largePages) {
+		uint8_t* base = (uint8_t*)mapSharedMemory(name, SharedDatasetMapSize, largePages, &dataset->sharedLockFd);
+		SharedDatasetHeader* header = (SharedDatasetHeader*)base;
+		dataset->shared = header;
+		dataset->memory = base + SharedDatasetHeaderSize;
+		static const uint64_t expectedMagic = sharedDatasetMagic();
+		uint64_t magic = 0;
+		if (!header->magic.compare_exchange_strong(magic, expectedMagic) && magic != expectedMagic)
+			throw std::runtime_error("allocSharedDataset - incompatible shared dataset");
+	}
+
+	void deallocSharedDataset(randomx_dataset* dataset) {
+		if (dataset->shared != nullptr)
+			freePagedMemory(dataset->shared, SharedDatasetMapSize);
+		closeSharedMemoryLock(dataset->sharedLockFd);
+	}
+
+	//how long a key switch waits for other processes to stop using the old contents
+	constexpr auto SharedDatasetSwitchTimeout = std::chrono::seconds(5);
+
+	int beginSharedDatasetInit(randomx_dataset* dataset, const void* key, size_t keySize) {
+		SharedDatasetHeader* header = dataset->shared;
+		if (header == nullptr)
+			return 1;
+		uint8_t seedTag[sizeof(header->seedTag)];
+		blake2b(seedTag, sizeof(seedTag), key, keySize, nullptr, 0);
+		//the reader lock is only taken while holding the fill lock, so there is no lock order inversion
+		unlockSharedMemory(dataset->sharedLockFd, SharedDatasetReaderLock);
+		lockSharedMemory(dataset->sharedLockFd, SharedDatasetFillLock, true);
+		if (header->ready.load() && memcmp(header->seedTag, seedTag, sizeof(seedTag)) == 0) {
+			lockSharedMemory(dataset->sharedLockFd, SharedDatasetReaderLock, false);
+			dataset->sharedGeneration = header->generation.load();
+			unlockSharedMemory(dataset->sharedLockFd, SharedDatasetFillLock);
+			return 0;
+		}
+		//a previous filler that exited without finishing left ready == 0; either way, wait until
+		//the processes using the old contents have switched keys or released the dataset.
+		//The wait is bounded because the fill lock blocks every other process meanwhile.
+		auto deadline = std::chrono::steady_clock::now() + SharedDatasetSwitchTimeout;
+		while (!tryLockSharedMemory(dataset->sharedLockFd, SharedDatasetReaderLock, true)) {
+			if (std::chrono::steady_clock::now() >= deadline) {
+				//the old contents are no longer claimed by this process either
+				dataset->sharedGeneration = std::numeric_limits<uint64_t>::max();
+				unlockSharedMemory(dataset->sharedLockFd, SharedDatasetFillLock);
+				return -1;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		header->ready.store(0);
+		header->generation.fetch_add(1);
+		memcpy(header->seedTag, seedTag, sizeof(seedTag));
+		return 1;
+	}
+
+	void endSharedDatasetInit(randomx_dataset* dataset) {
+		SharedDatasetHeader* header = dataset->shared;
+		if (header == nullptr)
+			return;
+		dataset->sharedGeneration = header->generation.load();
+		header->ready.store(1);
+		lockSharedMemory(dataset->sharedLockFd, SharedDatasetReaderLock, false);
+		unlockSharedMemory(dataset->sharedLockFd, SharedDatasetFillLock);
+	}
+
+	bool sharedDatasetCurrent(randomx_dataset* dataset) {
+		SharedDatasetHeader* header = dataset->shared;
+		return header == nullptr || (header->ready.load() && header->generation.load() == dataset->sharedGeneration);
+	}
 }
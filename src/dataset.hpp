@@ -33,13 +33,32 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <type_traits>
 #include "common.hpp"
 #include "superscalar_program.hpp"
+#include "superscalar.hpp"
 #include "allocator.hpp"
 #include "argon2.h"
 
+namespace randomx {
+	struct SharedDatasetHeader;
+	class LazyDatasetFill;
+}
+
 /* Global scope for C binding */
 struct randomx_dataset {
 	uint8_t* memory = nullptr;
 	randomx::DatasetDeallocFunc* dealloc;
+	randomx::SharedDatasetHeader* shared = nullptr;
+	int sharedLockFd = -1; //descriptor of a shared dataset used for the fill and reader locks
+	uint64_t sharedGeneration = 0; //generation of the shared dataset this process validated
+	randomx::LazyDatasetFill* lazy = nullptr;
+	uint32_t itemCount = randomx::DatasetSize / randomx::CacheLineSize; //less for a partial dataset
+
+	size_t getSize() const {
+		return (size_t)itemCount * randomx::CacheLineSize;
+	}
+
+	bool isPartial() const {
+		return itemCount < randomx::DatasetSize / randomx::CacheLineSize;
+	}
 };
 
 /* Global scope for C binding */
@@ -50,9 +69,11 @@ struct randomx_cache {
 	randomx::CacheInitializeFunc* initialize;
 	randomx::DatasetInitFunc* datasetInit;
 	randomx::SuperscalarProgram programs[RANDOMX_CACHE_ACCESSES];
+	std::vector<randomx::SuperscalarBytecode> superscalarBytecode[RANDOMX_CACHE_ACCESSES];
 	std::vector<uint64_t> reciprocalCache;
 	std::string cacheKey;
 	randomx_argon2_impl* argonImpl;
+	unsigned initThreads = 0;
 
 	bool isInitialized() {
 		return programs[0].getSize() != 0;
@@ -80,12 +101,22 @@ namespace randomx {
 	template<class Allocator>
 	void deallocDataset(randomx_dataset* dataset) {
 		if (dataset->memory != nullptr)
-			Allocator::freeMemory(dataset->memory, DatasetSize);
+			Allocator::freeMemory(dataset->memory, dataset->getSize());
 	}
 
 	template<class Allocator>
 	void deallocCache(randomx_cache* cache);
 
+	//datasets mapped from a named shared memory object; the dataset follows a header
+	//that records which seed the dataset holds and which process is filling it
+	void allocSharedDataset(randomx_dataset* dataset, const char* name, bool largePages);
+	void deallocSharedDataset(randomx_dataset* dataset);
+	int beginSharedDatasetInit(randomx_dataset* dataset, const void* key, size_t keySize);
+	void endSharedDatasetInit(randomx_dataset* dataset);
+	bool sharedDatasetCurrent(randomx_dataset* dataset);
+
+	//fills the Argon2 lanes using instance->threads threads, synchronized at each slice
+	void fillMemoryBlocks(argon2_instance_t* instance);
 	void initCache(randomx_cache*, const void*, size_t);
 	void initCacheCompile(randomx_cache*, const void*, size_t);
 	void initDatasetItem(randomx_cache* cache, uint8_t* out, uint64_t blockNumber);
@@ -0,0 +1,255 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdexcept>
+#include <cstring>
+
+#include "dataset_lazy.hpp"
+#include "dataset.hpp"
+#include "virtual_memory.hpp"
+#include "randomx.h"
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#if defined(__NR_userfaultfd)
+#include <linux/userfaultfd.h>
+#define RANDOMX_HAVE_USERFAULTFD
+#endif
+#endif
+
+namespace randomx {
+
+	//a fault blocks until the whole page has been computed, so gigantic pages are not supported
+	static const size_t LazyFillMaxPageSize = 2 * 1024 * 1024;
+
+#ifdef RANDOMX_HAVE_USERFAULTFD
+	static int openUserfaultfd() {
+		int fd = -1;
+#ifdef UFFD_USER_MODE_ONLY
+		//unprivileged processes may only handle faults from user mode
+		fd = (int)syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+#endif
+		if (fd < 0)
+			fd = (int)syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+		if (fd < 0)
+			throw std::runtime_error("LazyDatasetFill - userfaultfd is not available");
+		uffdio_api api;
+		memset(&api, 0, sizeof(api));
+		api.api = UFFD_API;
+		if (ioctl(fd, UFFDIO_API, &api) != 0) {
+			close(fd);
+			throw std::runtime_error("LazyDatasetFill - UFFDIO_API failed");
+		}
+		return fd;
+	}
+#endif
+
+	LazyDatasetFill::LazyDatasetFill(randomx_dataset* dataset, randomx_cache* cache, unsigned threadCount)
+		: cache(cache), datasetMemory(dataset->memory), background(threadCount > 0), nextPage(0), filledCount(0), stopping(false), failed(false)
+	{
+#ifdef RANDOMX_HAVE_USERFAULTFD
+		//writes to a shared dataset must go through the init ownership protocol
+		if (dataset->shared != nullptr)
+			throw std::runtime_error("LazyDatasetFill - shared datasets are not supported");
+		randomx_page_info info;
+		pageSize = getPageInfo(datasetMemory, dataset->getSize(), &info) ? info.page_size : 4096;
+		if (pageSize > LazyFillMaxPageSize)
+			throw std::runtime_error("LazyDatasetFill - page size is too large");
+		uint8_t* datasetEnd = datasetMemory + dataset->getSize();
+		begin = (uint8_t*)alignSize((uintptr_t)datasetMemory, pageSize);
+		uint8_t* end = (uint8_t*)((uintptr_t)datasetEnd / pageSize * pageSize);
+		if (end <= begin)
+			throw std::runtime_error("LazyDatasetFill - dataset is too small");
+		pageCount = (end - begin) / pageSize;
+		//4 KiB pages installed by userfaultfd split transparent huge pages, so they are collapsed when the dataset is full
+		collapse = dataset->dealloc != &deallocDataset<DefaultAllocator> && pageSize == 4096;
+		pageFilled.reset(new std::atomic<bool>[pageCount]);
+		for (size_t i = 0; i < pageCount; ++i)
+			pageFilled[i] = false;
+
+		uffd = openUserfaultfd();
+		//pages that are already present would not fault, so they are discarded
+		uffdio_register reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.range.start = (uintptr_t)begin;
+		reg.range.len = end - begin;
+		reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+		if (madvise(begin, end - begin, MADV_DONTNEED) != 0 || ioctl(uffd, UFFDIO_REGISTER, &reg) != 0) {
+			close(uffd);
+			throw std::runtime_error("LazyDatasetFill - cannot register the dataset");
+		}
+
+		//the partial pages at both ends are outside of the registered range
+		//(the JIT compiled init writes at least one item, so empty ranges must be skipped)
+		uint32_t beginItem = (uint32_t)((begin - datasetMemory) / CacheLineSize);
+		uint32_t endItem = (uint32_t)((end - datasetMemory) / CacheLineSize);
+		if (beginItem > 0)
+			cache->datasetInit(cache, datasetMemory, 0, beginItem);
+		if (endItem < dataset->itemCount)
+			cache->datasetInit(cache, end, endItem, dataset->itemCount);
+
+		for (unsigned i = 0; i < (background ? threadCount : 1); ++i)
+			workers.push_back(std::thread(&LazyDatasetFill::run, this, background));
+#else
+		throw std::runtime_error("LazyDatasetFill - userfaultfd is not supported");
+#endif
+	}
+
+	LazyDatasetFill::~LazyDatasetFill() {
+		stopping = true;
+		for (auto& worker : workers)
+			worker.join();
+#ifdef RANDOMX_HAVE_USERFAULTFD
+		if (uffd >= 0)
+			close(uffd);
+#endif
+	}
+
+	bool LazyDatasetFill::isReady() const {
+		return filledCount.load() == pageCount;
+	}
+
+	bool LazyDatasetFill::wait() {
+		//without background threads, the calling thread fills the remaining pages
+		if (!background) {
+			std::vector<uint8_t> buffer(pageSize);
+			while (fillNext(buffer.data()))
+				;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		ready.wait(lock, [this] { return isReady(); });
+		return !failed;
+	}
+
+	void LazyDatasetFill::run(bool sequential) {
+#ifdef RANDOMX_HAVE_USERFAULTFD
+		std::vector<uint8_t> buffer(pageSize);
+		while (!stopping && !isReady()) {
+			//faults have priority over the sequential fill
+			uffd_msg msg;
+			if (read(uffd, &msg, sizeof(msg)) == sizeof(msg)) {
+				if (msg.event == UFFD_EVENT_PAGEFAULT)
+					fillPage(((uint8_t*)(uintptr_t)msg.arg.pagefault.address - begin) / pageSize, buffer.data());
+				continue;
+			}
+			//there are no more faults after a failure, so the remaining pages must be filled here
+			if ((sequential || failed) && fillNext(buffer.data()))
+				continue;
+			pollfd pfd = { uffd, POLLIN, 0 };
+			poll(&pfd, 1, 10);
+		}
+#endif
+	}
+
+	bool LazyDatasetFill::fillNext(uint8_t* buffer) {
+		size_t page = nextPage.fetch_add(1);
+		if (page >= pageCount)
+			return false;
+		if (!pageFilled[page])
+			fillPage(page, buffer);
+		return true;
+	}
+
+	void LazyDatasetFill::fillPage(size_t page, uint8_t* buffer) {
+		uint8_t* dst = begin + page * pageSize;
+		uint32_t startItem = (uint32_t)((dst - datasetMemory) / CacheLineSize);
+		uint32_t endItem = startItem + (uint32_t)(pageSize / CacheLineSize);
+		if (failed) {
+			cache->datasetInit(cache, dst, startItem, endItem);
+		}
+		else {
+			cache->datasetInit(cache, buffer, startItem, endItem);
+			if (!copyPage(dst, buffer)) {
+				unregister();
+				cache->datasetInit(cache, dst, startItem, endItem);
+			}
+		}
+		if (!pageFilled[page].exchange(true) && filledCount.fetch_add(1) + 1 == pageCount)
+			finish();
+	}
+
+	bool LazyDatasetFill::copyPage(uint8_t* dst, uint8_t* buffer) {
+#ifdef RANDOMX_HAVE_USERFAULTFD
+		uffdio_copy copy;
+		memset(&copy, 0, sizeof(copy));
+		copy.dst = (uintptr_t)dst;
+		copy.src = (uintptr_t)buffer;
+		copy.len = pageSize;
+		while (ioctl(uffd, UFFDIO_COPY, &copy) != 0) {
+			if (errno == EEXIST) {
+				//installed by another thread; make sure no thread keeps waiting for it
+				uffdio_range range = { (uintptr_t)dst, pageSize };
+				ioctl(uffd, UFFDIO_WAKE, &range);
+				break;
+			}
+			if (errno != EAGAIN)
+				return false;
+			if (copy.copy > 0) {
+				copy.dst += copy.copy;
+				copy.src += copy.copy;
+				copy.len -= copy.copy;
+			}
+			copy.copy = 0;
+		}
+#endif
+		return true;
+	}
+
+	void LazyDatasetFill::unregister() {
+		//the dataset stops being lazy: faulting threads get empty pages until they are filled in place,
+		//so hashes calculated before the fill is complete may be invalid (reported by wait())
+		std::lock_guard<std::mutex> lock(mutex);
+		if (failed)
+			return;
+#ifdef RANDOMX_HAVE_USERFAULTFD
+		uffdio_range range = { (uintptr_t)begin, pageCount * pageSize };
+		ioctl(uffd, UFFDIO_UNREGISTER, &range);
+		ioctl(uffd, UFFDIO_WAKE, &range);
+#endif
+		failed = true;
+	}
+
+	void LazyDatasetFill::finish() {
+#ifdef RANDOMX_HAVE_USERFAULTFD
+		uffdio_range range = { (uintptr_t)begin, pageCount * pageSize };
+		ioctl(uffd, UFFDIO_UNREGISTER, &range);
+#ifdef MADV_COLLAPSE
+		if (collapse)
+			madvise(begin, pageCount * pageSize, MADV_COLLAPSE);
+#endif
+#endif
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.notify_all();
+	}
+}
@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "common.hpp"
+
+namespace randomx {
+
+	//Fills a dataset with background threads while it is already in use. The dataset is
+	//registered with userfaultfd, so pages that are read before they have been filled
+	//are computed on demand. Only supported on Linux.
+	class LazyDatasetFill {
+	public:
+		//threadCount = 0 computes pages only when they are accessed or when wait() is called
+		LazyDatasetFill(randomx_dataset* dataset, randomx_cache* cache, unsigned threadCount);
+		~LazyDatasetFill();
+		bool isReady() const;
+		//returns false if userfaultfd failed and pages had to be filled in place
+		bool wait();
+	private:
+		void run(bool sequential);
+		bool fillNext(uint8_t* buffer);
+		void fillPage(size_t page, uint8_t* buffer);
+		bool copyPage(uint8_t* dst, uint8_t* buffer);
+		void unregister();
+		void finish();
+		randomx_cache* cache;
+		uint8_t* datasetMemory;
+		uint8_t* begin;
+		size_t pageSize;
+		size_t pageCount;
+		bool collapse;
+		bool background;
+		int uffd = -1;
+		std::unique_ptr<std::atomic<bool>[]> pageFilled;
+		std::atomic<size_t> nextPage;
+		std::atomic<size_t> filledCount;
+		std::atomic<bool> stopping;
+		std::atomic<bool> failed;
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable ready;
+	};
+}
@@ -0,0 +1,296 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <stdexcept>
+#include "engine.hpp"
+#include "dataset.hpp"
+#include "virtual_machine.hpp"
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define RANDOMX_HAVE_EVENTFD
+#endif
+
+namespace randomx {
+
+	constexpr size_t EngineMaxBatch = 16;
+
+	static randomx_flags withoutFlag(randomx_flags flags, randomx_flags flag) {
+		return (randomx_flags)(flags & ~flag);
+	}
+
+}
+
+randomx_engine::randomx_engine(randomx_flags flags, unsigned threadCount, unsigned maxKeys) :
+	flags(randomx::withoutFlag(flags, RANDOMX_FLAG_FULL_MEM)), threadCount(std::max(1u, threadCount)), maxKeys(std::max(1u, maxKeys))
+{
+#ifdef RANDOMX_HAVE_EVENTFD
+	eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+	try {
+		for (unsigned i = 0; i < this->threadCount; ++i)
+			workers.push_back(std::thread(&randomx_engine::work, this));
+	}
+	catch (...) {
+		stop();
+		closeEventFd();
+		throw;
+	}
+}
+
+randomx_engine::~randomx_engine() {
+	stop();
+	for (auto& key : keys) {
+		if (key.second.cache != nullptr)
+			randomx_release_cache(key.second.cache);
+	}
+	keys.clear();
+	closeEventFd();
+}
+
+void randomx_engine::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+void randomx_engine::closeEventFd() {
+#ifdef RANDOMX_HAVE_EVENTFD
+	if (eventFd >= 0)
+		close(eventFd);
+	eventFd = -1;
+#endif
+}
+
+void randomx_engine::submit(const void* key, size_t keySize, const void* input, size_t inputSize, uint64_t userData) {
+	randomx::EngineJob job;
+	job.input.assign((const uint8_t*)input, (const uint8_t*)input + inputSize);
+	job.userData = userData;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job.sequence = sequence++;
+		keys[std::string((const char*)key, keySize)].jobs.push_back(std::move(job));
+	}
+	jobReady.notify_all();
+}
+
+unsigned randomx_engine::poll(randomx_engine_result* out, unsigned maxResults) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return popResults(out, maxResults);
+}
+
+unsigned randomx_engine::wait(randomx_engine_result* out, unsigned maxResults, unsigned timeoutMs) {
+	std::unique_lock<std::mutex> lock(mutex);
+	resultReady.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !results.empty(); });
+	return popResults(out, maxResults);
+}
+
+unsigned randomx_engine::popResults(randomx_engine_result* out, unsigned maxResults) {
+	unsigned count = (unsigned)std::min<size_t>(maxResults, results.size());
+	std::copy(results.begin(), results.begin() + count, out);
+	results.erase(results.begin(), results.begin() + count);
+#ifdef RANDOMX_HAVE_EVENTFD
+	//the descriptor stays readable while results are queued
+	if (results.empty() && eventFd >= 0) {
+		uint64_t value;
+		if (read(eventFd, &value, sizeof(value)) < 0) {
+			//counter was already zero
+		}
+	}
+#endif
+	return count;
+}
+
+void randomx_engine::complete(uint64_t userData, int status, const void* hash) {
+	randomx_engine_result result;
+	result.user_data = userData;
+	result.status = status;
+	if (hash != nullptr)
+		memcpy(result.hash, hash, RANDOMX_HASH_SIZE);
+	else
+		memset(result.hash, 0, RANDOMX_HASH_SIZE);
+	results.push_back(result);
+#ifdef RANDOMX_HAVE_EVENTFD
+	if (eventFd >= 0) {
+		uint64_t one = 1;
+		if (write(eventFd, &one, sizeof(one)) < 0) {
+			//counter overflow, the descriptor is readable anyway
+		}
+	}
+#endif
+}
+
+//Prefers the key the calling worker's VM already uses, then the key with the oldest job.
+std::map<std::string, randomx::EngineKey>::iterator randomx_engine::selectKey(uint64_t currentKeyId) {
+	auto best = keys.end();
+	for (auto it = keys.begin(); it != keys.end(); ++it) {
+		randomx::EngineKey& key = it->second;
+		if (key.jobs.empty() || key.initializing)
+			continue;
+		if (currentKeyId != 0 && key.id == currentKeyId)
+			return it;
+		if (best == keys.end() || key.jobs.front().sequence < best->second.jobs.front().sequence)
+			best = it;
+	}
+	return best;
+}
+
+//Allocates and initializes the cache of a key outside of the lock. Fails all jobs of the key
+//if the cache cannot be allocated.
+bool randomx_engine::prepareKey(std::unique_lock<std::mutex>& lock, std::map<std::string, randomx::EngineKey>::iterator it) {
+	randomx::EngineKey& key = it->second;
+	if (key.cache != nullptr)
+		return true;
+	key.initializing = true;
+	lock.unlock();
+	randomx_cache* cache = randomx_alloc_cache(flags);
+	if (cache == nullptr && (flags & RANDOMX_FLAG_LARGE_PAGES))
+		cache = randomx_alloc_cache(randomx::withoutFlag(flags, RANDOMX_FLAG_LARGE_PAGES));
+	if (cache != nullptr)
+		randomx_init_cache(cache, it->first.data(), it->first.size());
+	lock.lock();
+	key.initializing = false;
+	jobReady.notify_all();
+	if (cache == nullptr) {
+		for (auto& job : key.jobs)
+			complete(job.userData, 0, nullptr);
+		key.jobs.clear();
+		resultReady.notify_all();
+		return false;
+	}
+	key.cache = cache;
+	key.id = ++keyIds;
+	evictKeys();
+	return true;
+}
+
+//Releases the least recently used caches that are idle while more than maxKeys are allocated.
+void randomx_engine::evictKeys() {
+	size_t allocated = 0;
+	for (auto it = keys.begin(); it != keys.end();) {
+		randomx::EngineKey& key = it->second;
+		if (key.cache == nullptr && key.jobs.empty() && !key.initializing) {
+			it = keys.erase(it);
+			continue;
+		}
+		if (key.cache != nullptr)
+			allocated++;
+		++it;
+	}
+	while (allocated > maxKeys) {
+		auto victim = keys.end();
+		for (auto it = keys.begin(); it != keys.end(); ++it) {
+			randomx::EngineKey& key = it->second;
+			if (key.cache == nullptr || key.users != 0 || !key.jobs.empty())
+				continue;
+			if (victim == keys.end() || key.lastUsed < victim->second.lastUsed)
+				victim = it;
+		}
+		if (victim == keys.end())
+			break;
+		randomx_release_cache(victim->second.cache);
+		keys.erase(victim);
+		allocated--;
+	}
+}
+
+void randomx_engine::work() {
+	randomx_vm* vm = nullptr;
+	uint64_t currentKeyId = 0;
+	std::vector<randomx::EngineJob> batch;
+	std::vector<const void*> inputs;
+	std::vector<size_t> inputSizes;
+	std::vector<void*> outputs;
+	std::vector<char> hashes(randomx::EngineMaxBatch * RANDOMX_HASH_SIZE);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping) {
+		auto it = selectKey(currentKeyId);
+		if (it == keys.end()) {
+			jobReady.wait(lock);
+			continue;
+		}
+		if (!prepareKey(lock, it))
+			continue;
+		randomx::EngineKey& key = it->second;
+		//leave work for the other workers when many jobs of one key are queued
+		size_t count = std::min(randomx::EngineMaxBatch, std::max<size_t>(1, (key.jobs.size() + threadCount - 1) / threadCount));
+		count = std::min(count, key.jobs.size());
+		batch.clear();
+		for (size_t i = 0; i < count; ++i) {
+			batch.push_back(std::move(key.jobs.front()));
+			key.jobs.pop_front();
+		}
+		key.users++;
+		key.lastUsed = sequence;
+		randomx_cache* cache = key.cache;
+		uint64_t keyId = key.id;
+		lock.unlock();
+
+		if (vm == nullptr) {
+			vm = randomx_create_vm(flags, cache, nullptr);
+			if (vm == nullptr && (flags & RANDOMX_FLAG_LARGE_PAGES))
+				vm = randomx_create_vm(randomx::withoutFlag(flags, RANDOMX_FLAG_LARGE_PAGES), cache, nullptr);
+		}
+		else if (keyId != currentKeyId) {
+			//not randomx_vm_set_cache: a key that was evicted and submitted again has a new cache
+			vm->setCache(cache);
+			vm->cacheKey = cache->cacheKey;
+		}
+		if (vm != nullptr) {
+			currentKeyId = keyId;
+			inputs.clear();
+			inputSizes.clear();
+			outputs.clear();
+			for (size_t i = 0; i < count; ++i) {
+				inputs.push_back(batch[i].input.data());
+				inputSizes.push_back(batch[i].input.size());
+				outputs.push_back(&hashes[i * RANDOMX_HASH_SIZE]);
+			}
+			randomx_calculate_hash_batch(vm, inputs.data(), inputSizes.data(), outputs.data(), (unsigned)count);
+		}
+
+		lock.lock();
+		key.users--;
+		for (size_t i = 0; i < count; ++i)
+			complete(batch[i].userData, vm != nullptr, vm != nullptr ? outputs[i] : nullptr);
+		resultReady.notify_all();
+		evictKeys();
+	}
+	lock.unlock();
+	if (vm != nullptr)
+		randomx_destroy_vm(vm);
+}
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+#include "randomx.h"
+
+namespace randomx {
+
+	struct EngineJob {
+		std::vector<uint8_t> input;
+		uint64_t userData;
+		uint64_t sequence;
+	};
+
+	//jobs and the light-mode cache of one key
+	struct EngineKey {
+		randomx_cache* cache = nullptr;
+		uint64_t id = 0; //identifies the cache, assigned when it is initialized
+		bool initializing = false;
+		unsigned users = 0;
+		uint64_t lastUsed = 0;
+		std::deque<EngineJob> jobs;
+	};
+
+}
+
+/* Global namespace for C binding */
+//Hashes jobs submitted from any thread with a pool of light-mode VMs. Jobs with the
+//same key are hashed in batches on VMs that already use that key's cache.
+class randomx_engine {
+public:
+	randomx_engine(randomx_flags flags, unsigned threadCount, unsigned maxKeys);
+	~randomx_engine();
+	void submit(const void* key, size_t keySize, const void* input, size_t inputSize, uint64_t userData);
+	unsigned poll(randomx_engine_result* results, unsigned maxResults);
+	unsigned wait(randomx_engine_result* results, unsigned maxResults, unsigned timeoutMs);
+	int fd() const {
+		return eventFd;
+	}
+private:
+	void work();
+	void stop();
+	void closeEventFd();
+	std::map<std::string, randomx::EngineKey>::iterator selectKey(uint64_t currentKeyId);
+	bool prepareKey(std::unique_lock<std::mutex>& lock, std::map<std::string, randomx::EngineKey>::iterator key);
+	void evictKeys();
+	void complete(uint64_t userData, int status, const void* hash);
+	unsigned popResults(randomx_engine_result* results, unsigned maxResults);
+	randomx_flags flags;
+	unsigned threadCount;
+	unsigned maxKeys;
+	bool stopping = false;
+	uint64_t sequence = 0;
+	uint64_t keyIds = 0;
+	std::map<std::string, randomx::EngineKey> keys;
+	std::deque<randomx_engine_result> results;
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::condition_variable resultReady;
+	std::vector<std::thread> workers;
+	int eventFd = -1;
+};
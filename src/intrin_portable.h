@@ -103,6 +103,8 @@ typedef __m128d rx_vec_f128;
 #define rx_aligned_free(a) _mm_free(a)
 #define rx_prefetch_nta(x) _mm_prefetch((const char *)(x), _MM_HINT_NTA)
 #define rx_prefetch_t0(x) _mm_prefetch((const char *)(x), _MM_HINT_T0)
+#define rx_prefetch_t1(x) _mm_prefetch((const char *)(x), _MM_HINT_T1)
+#define rx_prefetch_t2(x) _mm_prefetch((const char *)(x), _MM_HINT_T2)
 
 #define rx_load_vec_f128 _mm_load_pd
 #define rx_store_vec_f128 _mm_store_pd
@@ -207,6 +209,8 @@ typedef union{
 #define rx_aligned_free(a) free(a)
 #define rx_prefetch_nta(x)
 #define rx_prefetch_t0(x)
+#define rx_prefetch_t1(x)
+#define rx_prefetch_t2(x)
 
 /* Splat 64-bit long long to 2 64-bit long longs */
 FORCE_INLINE __m128i vec_splat2sd (int64_t scalar)
@@ -409,6 +413,14 @@ inline void rx_prefetch_t0(const void* ptr) {
 	asm volatile ("prfm pldl1strm, [%0]\n" : : "r" (ptr));
 }
 
+inline void rx_prefetch_t1(const void* ptr) {
+	asm volatile ("prfm pldl2keep, [%0]\n" : : "r" (ptr));
+}
+
+inline void rx_prefetch_t2(const void* ptr) {
+	asm volatile ("prfm pldl3keep, [%0]\n" : : "r" (ptr));
+}
+
 FORCE_INLINE rx_vec_f128 rx_load_vec_f128(const double* pd) {
 	return vld1q_f64((const float64_t*)pd);
 }
@@ -543,6 +555,8 @@ typedef union {
 #define rx_aligned_free(a) free(a)
 #define rx_prefetch_nta(x)
 #define rx_prefetch_t0(x)
+#define rx_prefetch_t1(x)
+#define rx_prefetch_t2(x)
 
 FORCE_INLINE rx_vec_f128 rx_load_vec_f128(const double* pd) {
 	rx_vec_f128 x;
@@ -51,6 +51,9 @@ namespace randomx {
 
 		void generateProgram(Program&, ProgramConfiguration&);
 		void generateProgramLight(Program&, ProgramConfiguration&, uint32_t);
+		//dataset items are always computed (same result, no speedup from a partial dataset)
+		void setDatasetPrefix(const uint8_t*, uint32_t) {}
+		void setPrefetchMode(randomx_prefetch_mode) {}
 
 		template<size_t N>
 		void generateSuperscalarHash(SuperscalarProgram(&programs)[N], std::vector<uint64_t> &);
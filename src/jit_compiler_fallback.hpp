@@ -49,6 +49,12 @@ namespace randomx {
 		}
 		void generateProgramLight(Program&, ProgramConfiguration&, uint32_t) {
 
+		}
+		void setDatasetPrefix(const uint8_t*, uint32_t) {
+
+		}
+		void setPrefetchMode(randomx_prefetch_mode) {
+
 		}
 		template<size_t N>
 		void generateSuperscalarHash(SuperscalarProgram(&programs)[N], std::vector<uint64_t> &) {
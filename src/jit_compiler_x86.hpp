@@ -53,6 +53,13 @@ namespace randomx {
 
 		void generateProgram(const Program&, const ProgramConfiguration&);
 		void generateProgramLight(const Program&, const ProgramConfiguration&, uint32_t);
+		void setDatasetPrefix(const uint8_t* memory, uint32_t itemCount) {
+			datasetPrefix = memory;
+			datasetPrefixItems = itemCount;
+		}
+		void setPrefetchMode(randomx_prefetch_mode mode) {
+			prefetchMode = mode;
+		}
 		template<size_t N>
 		void generateSuperscalarHash(SuperscalarProgram (&programs)[N], const std::vector<uint64_t> &);
 		void generateDatasetInitCode();
@@ -93,9 +100,14 @@ namespace randomx {
 
 		uint8_t* const code;
 		uint8_t* codePos;
+		bool hasBmi2;
+		const uint8_t* datasetPrefix = nullptr;
+		uint32_t datasetPrefixItems = 0;
+		randomx_prefetch_mode prefetchMode = RANDOMX_PREFETCH_NTA;
 
 		void generateProgramPrologue(const Program&, const ProgramConfiguration&);
 		void generateProgramEpilogue(const Program&, const ProgramConfiguration&);
+		void patchDatasetPrefetch(uint8_t* readDataset);
 		void genAddressRegRax(const Instruction&, uint8_t reg);
 
 		inline void genAddressImm(const Instruction& instr) {
@@ -113,6 +125,7 @@ namespace randomx {
 		}
 
 		void generateSuperscalarCode(const Instruction&, const std::vector<uint64_t> &);
+		void genMulhR(int dst, int src);
 
 		inline void emitByte(uint8_t val) {
 			*codePos++ = val;
@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "perf_counters.hpp"
+#include "randomx.h"
+#include "cpu.hpp"
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#if defined(__NR_perf_event_open)
+#include <linux/perf_event.h>
+#define RANDOMX_HAVE_PERF_EVENTS
+#endif
+#endif
+
+namespace randomx {
+
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+	static constexpr uint64_t cacheEvent(uint64_t cache, uint64_t op, uint64_t result) {
+		return cache | (op << 8) | (result << 16);
+	}
+
+	//L2 misses have no generic perf event, so a raw event is used where it is known
+	static bool rawL2MissEvent(__u64& config) {
+#if defined(__x86_64__)
+		static const Cpu cpu;
+		switch (cpu.vendor()) {
+		case CpuVendorIntel:
+			config = 0x3f24; //L2_RQSTS.MISS (Haswell and newer)
+			return true;
+		case CpuVendorAmd:
+			config = 0x0964; //L2_CACHE_REQ_STAT.IC_DC_MISS_IN_L2 (Zen)
+			return true;
+		default:
+			return false;
+		}
+#else
+		return false;
+#endif
+	}
+
+	static int openCounter(PerfCounter counter) {
+		perf_event_attr attr = {};
+		attr.size = sizeof(attr);
+		switch (counter) {
+		case PerfCycles:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfInstructions:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfL1dMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			break;
+		case PerfL2Misses:
+			attr.type = PERF_TYPE_RAW;
+			if (!rawL2MissEvent(attr.config))
+				return -1;
+			break;
+		case PerfLlcMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = cacheEvent(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			break;
+		case PerfDtlbMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = cacheEvent(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+			break;
+		case PerfBranchMisses:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		default:
+			return -1;
+		}
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		//the counters are opened separately rather than as a group, so they can be
+		//multiplexed when there are fewer hardware counters than events
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+	}
+#endif
+
+	PerfCounters::PerfCounters() {
+		for (int i = 0; i < PerfCounterCount; ++i) {
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+			fds[i] = openCounter((PerfCounter)i);
+#else
+			fds[i] = -1;
+#endif
+		}
+	}
+
+	PerfCounters::~PerfCounters() {
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+		for (int fd : fds) {
+			if (fd >= 0)
+				close(fd);
+		}
+#endif
+	}
+
+	unsigned PerfCounters::available() const {
+		unsigned count = 0;
+		for (int fd : fds) {
+			if (fd >= 0)
+				count++;
+		}
+		return count;
+	}
+
+	void PerfCounters::start() {
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+		for (int fd : fds) {
+			if (fd >= 0)
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	void PerfCounters::stop() {
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+		for (int fd : fds) {
+			if (fd >= 0)
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+#endif
+	}
+
+	void PerfCounters::reset() {
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+		for (int fd : fds) {
+			if (fd >= 0)
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		}
+#endif
+		hashes = 0;
+	}
+
+	void PerfCounters::read(randomx_perf_counters* out) const {
+		uint64_t values[PerfCounterCount];
+		for (int i = 0; i < PerfCounterCount; ++i) {
+			values[i] = RANDOMX_PERF_UNAVAILABLE;
+#ifdef RANDOMX_HAVE_PERF_EVENTS
+			uint64_t data[3]; //value, time enabled, time running
+			if (fds[i] >= 0 && ::read(fds[i], data, sizeof(data)) == sizeof(data)) {
+				//scale multiplexed counters to the whole time they were enabled
+				if (data[2] == 0)
+					values[i] = 0;
+				else if (data[2] < data[1])
+					values[i] = (uint64_t)((double)data[0] * data[1] / data[2]);
+				else
+					values[i] = data[0];
+			}
+#endif
+		}
+		out->cycles = values[PerfCycles];
+		out->instructions = values[PerfInstructions];
+		out->l1d_misses = values[PerfL1dMisses];
+		out->l2_misses = values[PerfL2Misses];
+		out->llc_misses = values[PerfLlcMisses];
+		out->dtlb_misses = values[PerfDtlbMisses];
+		out->branch_misses = values[PerfBranchMisses];
+		out->hashes = hashes;
+	}
+}
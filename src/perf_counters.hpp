@@ -0,0 +1,83 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+struct randomx_perf_counters;
+
+namespace randomx {
+
+	enum PerfCounter {
+		PerfCycles,
+		PerfInstructions,
+		PerfL1dMisses,
+		PerfL2Misses,
+		PerfLlcMisses,
+		PerfDtlbMisses,
+		PerfBranchMisses,
+		PerfCounterCount
+	};
+
+	//Hardware performance counters of the thread that created the object, counting only
+	//between start() and stop(). Counters that cannot be opened are skipped, so this
+	//never fails; available() returns 0 if perf events are not supported at all.
+	class PerfCounters {
+	public:
+		PerfCounters();
+		~PerfCounters();
+		unsigned available() const;
+		void start();
+		void stop();
+		void reset();
+		void read(randomx_perf_counters* out) const;
+		uint64_t hashes = 0;
+	private:
+		int fds[PerfCounterCount];
+	};
+
+	//enables the counters of a VM (if any) for the lifetime of the object
+	class PerfScope {
+	public:
+		PerfScope(PerfCounters* perf, bool finishesHash) : perf(perf), finishesHash(finishesHash) {
+			if (perf != nullptr)
+				perf->start();
+		}
+		~PerfScope() {
+			if (perf != nullptr) {
+				perf->stop();
+				if (finishesHash)
+					perf->hashes++;
+			}
+		}
+	private:
+		PerfCounters* perf;
+		bool finishesHash;
+	};
+}
@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef RANDOMX_PROFILE
+#include <chrono>
+#endif
+
+namespace randomx {
+
+	enum ProfilePhase {
+		ProfileFillScratchpad,  //fillAes1Rx4
+		ProfileGenerateProgram, //fillAes4Rx4
+		ProfileCompile,         //JIT compilation or bytecode generation
+		ProfileExecute,         //program execution
+		ProfileBlake2b,
+		ProfileFinalHash,       //hashAes1Rx4, fused with the next fillAes1Rx4 in randomx_calculate_hash_next
+		ProfilePhaseCount
+	};
+
+	struct ProfileCounters {
+		uint64_t nanoseconds[ProfilePhaseCount];
+		uint64_t hashes;
+	};
+
+#ifdef RANDOMX_PROFILE
+	class ProfileScope {
+	public:
+		ProfileScope(ProfileCounters& counters, ProfilePhase phase)
+			: counters(counters), phase(phase), start(std::chrono::steady_clock::now()) {}
+		~ProfileScope() {
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			counters.nanoseconds[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+		}
+	private:
+		ProfileCounters& counters;
+		ProfilePhase phase;
+		std::chrono::steady_clock::time_point start;
+	};
+
+#define RANDOMX_PROFILE_SCOPE(machine, phase) randomx::ProfileScope profileScope((machine)->profile, randomx::phase)
+#define RANDOMX_PROFILE_HASH(machine) (machine)->profile.hashes++
+#else
+#define RANDOMX_PROFILE_SCOPE(machine, phase)
+#define RANDOMX_PROFILE_HASH(machine)
+#endif
+}
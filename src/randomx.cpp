@@ -34,15 +34,73 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "vm_compiled_light.hpp"
 #include "blake2/blake2.h"
 #include "cpu.hpp"
+#include "aes_hash.hpp"
+#include "virtual_memory.hpp"
+#include "dataset_lazy.hpp"
+#include "perf_counters.hpp"
+#include "autotune.hpp"
+#include "engine.hpp"
 #include <cassert>
+#include <cstring>
 #include <limits>
 #include <cfenv>
 
+namespace randomx {
+
+	//selects the SIMD blake2b implementations once when the library is loaded
+	static struct Blake2bDispatch {
+		Blake2bDispatch() {
+			Cpu cpu;
+			randomx_blake2b_select_impl(cpu.hasAvx2(), cpu.hasAvx512());
+		}
+	} blake2bDispatch;
+
+	//number of the given VMs that can share multi-buffer AES (4, 2 or 1)
+	static unsigned vaesGroupSize(randomx_vm** machines, unsigned count) {
+		static const Cpu cpu;
+		if (!hasVaesKernels() || !cpu.hasVaes())
+			return 1;
+		unsigned group = 1;
+		if (count >= 4 && cpu.hasAvx512() && hasVaes512Kernels())
+			group = 4;
+		else if (count >= 2 && cpu.hasAvx2())
+			group = 2;
+		for (unsigned i = 0; i < group; ++i) {
+			if (!machines[i]->hasHardwareAes())
+				return 1;
+		}
+		return group;
+	}
+
+	//blake2b of the program input or of the register file, timed as its own phase when profiling
+	static inline void hashSeed(randomx_vm* machine, void* seed, const void* input, size_t inputSize) {
+		RANDOMX_PROFILE_SCOPE(machine, ProfileBlake2b);
+		int blakeResult = blake2b(seed, 64, input, inputSize, nullptr, 0);
+		assert(blakeResult == 0);
+		(void)blakeResult;
+	}
+
+	static inline void hashRegisters(randomx_vm* machine, void* seed) {
+		hashSeed(machine, seed, machine->getRegisterFile(), sizeof(RegisterFile));
+	}
+
+	//runs the chain of RANDOMX_PROGRAM_COUNT programs of one hash
+	static inline void runPrograms(randomx_vm* machine, void* seed) {
+		machine->resetRoundingMode();
+		for (int chain = 0; chain < RANDOMX_PROGRAM_COUNT - 1; ++chain) {
+			machine->run(seed);
+			hashRegisters(machine, seed);
+		}
+		machine->run(seed);
+	}
+
+}
+
 extern "C" {
 
 	randomx_flags randomx_get_flags() {
 		randomx_flags flags = RANDOMX_HAVE_COMPILER ? RANDOMX_FLAG_JIT : RANDOMX_FLAG_DEFAULT;
-		randomx::Cpu cpu;
+		static const randomx::Cpu cpu;
 #ifdef __OpenBSD__
 		if (flags == RANDOMX_FLAG_JIT) {
 			flags |= RANDOMX_FLAG_SECURE;
@@ -128,6 +186,11 @@ extern "C" {
 		}
 	}
 
+	void randomx_cache_set_init_threads(randomx_cache *cache, unsigned threads) {
+		assert(cache != nullptr);
+		cache->initThreads = threads;
+	}
+
 	void randomx_release_cache(randomx_cache* cache) {
 		assert(cache != nullptr);
 		if (cache->memory != nullptr) {
@@ -136,24 +199,40 @@ extern "C" {
 		delete cache;
 	}
 
+	constexpr unsigned long DatasetItemCount = randomx::DatasetSize / RANDOMX_DATASET_ITEM_SIZE;
+
 	randomx_dataset *randomx_alloc_dataset(randomx_flags flags) {
+		return randomx_alloc_dataset_partial(flags, DatasetItemCount);
+	}
+
+	randomx_dataset *randomx_alloc_dataset_partial(randomx_flags flags, unsigned long itemCount) {
 
 		//fail on 32-bit systems if DatasetSize is >= 4 GiB
 		if (randomx::DatasetSize > std::numeric_limits<size_t>::max()) {
 			return nullptr;
 		}
 
+		if (itemCount == 0 || itemCount > DatasetItemCount) {
+			return nullptr;
+		}
+
 		randomx_dataset *dataset = nullptr;
 
 		try {
 			dataset = new randomx_dataset();
-			if (flags & RANDOMX_FLAG_LARGE_PAGES) {
+			dataset->itemCount = itemCount;
+			const size_t datasetSize = dataset->getSize();
+			if ((flags & RANDOMX_FLAG_LARGE_PAGES) && (flags & RANDOMX_FLAG_FIRST_TOUCH)) {
+				dataset->dealloc = &randomx::deallocDataset<randomx::LargePageFirstTouchAllocator>;
+				dataset->memory = (uint8_t*)randomx::LargePageFirstTouchAllocator::allocMemory(datasetSize);
+			}
+			else if (flags & RANDOMX_FLAG_LARGE_PAGES) {
 				dataset->dealloc = &randomx::deallocDataset<randomx::LargePageAllocator>;
-				dataset->memory = (uint8_t*)randomx::LargePageAllocator::allocMemory(randomx::DatasetSize);
+				dataset->memory = (uint8_t*)randomx::LargePageAllocator::allocMemory(datasetSize);
 			}
 			else {
 				dataset->dealloc = &randomx::deallocDataset<randomx::DefaultAllocator>;
-				dataset->memory = (uint8_t*)randomx::DefaultAllocator::allocMemory(randomx::DatasetSize);
+				dataset->memory = (uint8_t*)randomx::DefaultAllocator::allocMemory(datasetSize);
 			}
 		}
 		catch (std::exception &ex) {
@@ -166,7 +245,48 @@ extern "C" {
 		return dataset;
 	}
 
-	constexpr unsigned long DatasetItemCount = randomx::DatasetSize / RANDOMX_DATASET_ITEM_SIZE;
+	randomx_dataset *randomx_alloc_dataset_shared(const char *name, randomx_flags flags) {
+
+		if (randomx::DatasetSize > std::numeric_limits<size_t>::max()) {
+			return nullptr;
+		}
+
+		randomx_dataset *dataset = nullptr;
+
+		try {
+			dataset = new randomx_dataset();
+			dataset->dealloc = &randomx::deallocSharedDataset;
+			randomx::allocSharedDataset(dataset, name, flags & RANDOMX_FLAG_LARGE_PAGES);
+		}
+		catch (std::exception &ex) {
+			if (dataset != nullptr) {
+				randomx_release_dataset(dataset);
+				dataset = nullptr;
+			}
+		}
+
+		return dataset;
+	}
+
+	int randomx_unlink_dataset_shared(const char *name) {
+		try {
+			return unlinkSharedMemory(name);
+		}
+		catch (std::exception &ex) {
+			return 0;
+		}
+	}
+
+	int randomx_begin_dataset_init(randomx_dataset *dataset, const void *key, size_t keySize) {
+		assert(dataset != nullptr);
+		assert(keySize == 0 || key != nullptr);
+		return randomx::beginSharedDatasetInit(dataset, key, keySize);
+	}
+
+	void randomx_end_dataset_init(randomx_dataset *dataset) {
+		assert(dataset != nullptr);
+		randomx::endSharedDatasetInit(dataset);
+	}
 
 	unsigned long randomx_dataset_item_count() {
 		return DatasetItemCount;
@@ -175,11 +295,41 @@ extern "C" {
 	void randomx_init_dataset(randomx_dataset *dataset, randomx_cache *cache, unsigned long startItem, unsigned long itemCount) {
 		assert(dataset != nullptr);
 		assert(cache != nullptr);
-		assert(startItem < DatasetItemCount && itemCount <= DatasetItemCount);
-		assert(startItem + itemCount <= DatasetItemCount);
+		assert(startItem < dataset->itemCount && itemCount <= dataset->itemCount);
+		assert(startItem + itemCount <= dataset->itemCount);
 		cache->datasetInit(cache, dataset->memory + startItem * randomx::CacheLineSize, startItem, startItem + itemCount);
 	}
 
+	int randomx_init_dataset_lazy(randomx_dataset *dataset, randomx_cache *cache, unsigned threadCount) {
+		assert(dataset != nullptr);
+		assert(cache != nullptr && cache->isInitialized());
+		delete dataset->lazy;
+		dataset->lazy = nullptr;
+		try {
+			dataset->lazy = new randomx::LazyDatasetFill(dataset, cache, threadCount);
+		}
+		catch (std::exception &ex) {
+			return 0;
+		}
+		return 1;
+	}
+
+	int randomx_dataset_ready(randomx_dataset *dataset) {
+		assert(dataset != nullptr);
+		return (dataset->lazy == nullptr || dataset->lazy->isReady()) && randomx::sharedDatasetCurrent(dataset);
+	}
+
+	int randomx_wait_dataset(randomx_dataset *dataset) {
+		assert(dataset != nullptr);
+		bool valid = true;
+		if (dataset->lazy != nullptr) {
+			valid = dataset->lazy->wait();
+			delete dataset->lazy;
+			dataset->lazy = nullptr;
+		}
+		return valid;
+	}
+
 	void *randomx_get_dataset_memory(randomx_dataset *dataset) {
 		assert(dataset != nullptr);
 		return dataset->memory;
@@ -187,6 +337,7 @@ extern "C" {
 
 	void randomx_release_dataset(randomx_dataset *dataset) {
 		assert(dataset != nullptr);
+		delete dataset->lazy;
 		dataset->dealloc(dataset);
 		delete dataset;
 	}
@@ -198,6 +349,19 @@ extern "C" {
 
 		randomx_vm *vm = nullptr;
 
+		if ((flags & RANDOMX_FLAG_FULL_MEM) && dataset == nullptr) {
+			return nullptr;
+		}
+
+		//a partial dataset is used by a light VM that computes the missing items
+		const bool partialDataset = (flags & RANDOMX_FLAG_FULL_MEM) && dataset != nullptr && dataset->isPartial();
+		if (partialDataset) {
+			if (cache == nullptr) {
+				return nullptr;
+			}
+			flags = (randomx_flags)(flags & ~RANDOMX_FLAG_FULL_MEM);
+		}
+
 		try {
 			switch ((int)(flags & (RANDOMX_FLAG_FULL_MEM | RANDOMX_FLAG_JIT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_LARGE_PAGES))) {
 				case RANDOMX_FLAG_DEFAULT:
@@ -261,7 +425,15 @@ extern "C" {
 					break;
 
 				case RANDOMX_FLAG_JIT | RANDOMX_FLAG_LARGE_PAGES:
-					if (flags & RANDOMX_FLAG_SECURE) {
+					if (flags & RANDOMX_FLAG_SCRATCHPAD_ARENA) {
+						if (flags & RANDOMX_FLAG_SECURE) {
+							vm = new randomx::CompiledLightVmArenaSecure();
+						}
+						else {
+							vm = new randomx::CompiledLightVmArena();
+						}
+					}
+					else if (flags & RANDOMX_FLAG_SECURE) {
 						vm = new randomx::CompiledLightVmLargePageSecure();
 					}
 					else {
@@ -270,7 +442,15 @@ extern "C" {
 					break;
 
 				case RANDOMX_FLAG_FULL_MEM | RANDOMX_FLAG_JIT | RANDOMX_FLAG_LARGE_PAGES:
-					if (flags & RANDOMX_FLAG_SECURE) {
+					if (flags & RANDOMX_FLAG_SCRATCHPAD_ARENA) {
+						if (flags & RANDOMX_FLAG_SECURE) {
+							vm = new randomx::CompiledVmArenaSecure();
+						}
+						else {
+							vm = new randomx::CompiledVmArena();
+						}
+					}
+					else if (flags & RANDOMX_FLAG_SECURE) {
 						vm = new randomx::CompiledVmLargePageSecure();
 					}
 					else {
@@ -287,7 +467,15 @@ extern "C" {
 					break;
 
 				case RANDOMX_FLAG_JIT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_LARGE_PAGES:
-					if (flags & RANDOMX_FLAG_SECURE) {
+					if (flags & RANDOMX_FLAG_SCRATCHPAD_ARENA) {
+						if (flags & RANDOMX_FLAG_SECURE) {
+							vm = new randomx::CompiledLightVmArenaHardAesSecure();
+						}
+						else {
+							vm = new randomx::CompiledLightVmArenaHardAes();
+						}
+					}
+					else if (flags & RANDOMX_FLAG_SECURE) {
 						vm = new randomx::CompiledLightVmLargePageHardAesSecure();
 					}
 					else {
@@ -296,7 +484,15 @@ extern "C" {
 					break;
 
 				case RANDOMX_FLAG_FULL_MEM | RANDOMX_FLAG_JIT | RANDOMX_FLAG_HARD_AES | RANDOMX_FLAG_LARGE_PAGES:
-					if (flags & RANDOMX_FLAG_SECURE) {
+					if (flags & RANDOMX_FLAG_SCRATCHPAD_ARENA) {
+						if (flags & RANDOMX_FLAG_SECURE) {
+							vm = new randomx::CompiledVmArenaHardAesSecure();
+						}
+						else {
+							vm = new randomx::CompiledVmArenaHardAes();
+						}
+					}
+					else if (flags & RANDOMX_FLAG_SECURE) {
 						vm = new randomx::CompiledVmLargePageHardAesSecure();
 					}
 					else {
@@ -313,9 +509,10 @@ extern "C" {
 				vm->cacheKey = cache->cacheKey;
 			}
 
-			if(dataset != nullptr)
+			if(dataset != nullptr && ((flags & RANDOMX_FLAG_FULL_MEM) || partialDataset))
 				vm->setDataset(dataset);
 
+			vm->setBitsliceAes((flags & RANDOMX_FLAG_BITSLICE_AES) != 0);
 			vm->allocate();
 		}
 		catch (std::exception &ex) {
@@ -335,6 +532,12 @@ extern "C" {
 		}
 	}
 
+	void randomx_vm_set_prefetch_mode(randomx_vm *machine, randomx_prefetch_mode mode) {
+		assert(machine != nullptr);
+		assert(mode >= RANDOMX_PREFETCH_NTA && mode < RANDOMX_PREFETCH_MODES);
+		machine->setPrefetchMode(mode);
+	}
+
 	void randomx_vm_set_dataset(randomx_vm *machine, randomx_dataset *dataset) {
 		assert(machine != nullptr);
 		assert(dataset != nullptr);
@@ -346,52 +549,299 @@ extern "C" {
 		delete machine;
 	}
 
+	void randomx_set_scratchpad_colours(unsigned colours) {
+		randomx::ScratchpadArenaAllocator::setColours(colours);
+	}
+
 	void randomx_calculate_hash(randomx_vm *machine, const void *input, size_t inputSize, void *output) {
 		assert(machine != nullptr);
 		assert(inputSize == 0 || input != nullptr);
 		assert(output != nullptr);
+		randomx::PerfScope perfScope(machine->perf, true);
 		fenv_t fpstate;
 		fegetenv(&fpstate);
 		alignas(16) uint64_t tempHash[8];
-		int blakeResult = blake2b(tempHash, sizeof(tempHash), input, inputSize, nullptr, 0);
-		assert(blakeResult == 0);
+		randomx::hashSeed(machine, tempHash, input, inputSize);
 		machine->initScratchpad(&tempHash);
-		machine->resetRoundingMode();
-		for (int chain = 0; chain < RANDOMX_PROGRAM_COUNT - 1; ++chain) {
-			machine->run(&tempHash);
-			blakeResult = blake2b(tempHash, sizeof(tempHash), machine->getRegisterFile(), sizeof(randomx::RegisterFile), nullptr, 0);
+		randomx::runPrograms(machine, tempHash);
+		machine->getFinalResult(output, RANDOMX_HASH_SIZE);
+		fesetenv(&fpstate);
+	}
+
+	void randomx_calculate_hash_multi(randomx_vm **machines, const void * const *inputs, const size_t *inputSizes, void * const *outputs, unsigned count) {
+		assert(count == 0 || (machines != nullptr && inputs != nullptr && inputSizes != nullptr && outputs != nullptr));
+		fenv_t fpstate;
+		fegetenv(&fpstate);
+		for (unsigned i = 0; i < count;) {
+			unsigned group = randomx::vaesGroupSize(machines + i, count - i);
+			if (group == 1) {
+				randomx_calculate_hash(machines[i], inputs[i], inputSizes[i], outputs[i]);
+				++i;
+				continue;
+			}
+			alignas(16) uint64_t tempHash[4][8];
+			void* seeds[4];
+			void* scratchpads[4];
+			void* finalHashes[4];
+			const void* registerFiles[4];
+			bool sameSize = true;
+			for (unsigned k = 0; k < group; ++k) {
+				randomx_vm* machine = machines[i + k];
+				assert(machine != nullptr);
+				assert(inputSizes[i + k] == 0 || inputs[i + k] != nullptr);
+				assert(outputs[i + k] != nullptr);
+				sameSize = sameSize && inputSizes[i + k] == inputSizes[i];
+				seeds[k] = tempHash[k];
+				scratchpads[k] = (void*)machine->getScratchpad();
+				finalHashes[k] = &machine->getRegisterFile()->a;
+				registerFiles[k] = machine->getRegisterFile();
+			}
+			//phases shared by the whole group are profiled and counted on its first VM
+			{
+				randomx::PerfScope perfScope(machines[i]->perf, false);
+				if (sameSize) {
+					RANDOMX_PROFILE_SCOPE(machines[i], ProfileBlake2b);
+					int blakeResult = blake2b_many(seeds, sizeof(tempHash[0]), inputs + i, inputSizes[i], group);
+					assert(blakeResult == 0);
+				}
+				else {
+					for (unsigned k = 0; k < group; ++k) {
+						randomx::hashSeed(machines[i + k], tempHash[k], inputs[i + k], inputSizes[i + k]);
+					}
+				}
+				RANDOMX_PROFILE_SCOPE(machines[i], ProfileFillScratchpad);
+				fillAes1Rx4Vaes(group, seeds, randomx::ScratchpadSize, scratchpads);
+			}
+			for (unsigned k = 0; k < group; ++k) {
+				randomx_vm* machine = machines[i + k];
+				randomx::PerfScope perfScope(machine->perf, true);
+				randomx::runPrograms(machine, tempHash[k]);
+				RANDOMX_PROFILE_HASH(machine);
+			}
+			randomx::PerfScope perfScope(machines[i]->perf, false);
+			{
+				RANDOMX_PROFILE_SCOPE(machines[i], ProfileFinalHash);
+				hashAes1Rx4Vaes(group, scratchpads, randomx::ScratchpadSize, finalHashes);
+			}
+			RANDOMX_PROFILE_SCOPE(machines[i], ProfileBlake2b);
+			int blakeResult = blake2b_many(outputs + i, RANDOMX_HASH_SIZE, registerFiles, sizeof(randomx::RegisterFile), group);
 			assert(blakeResult == 0);
+			i += group;
 		}
-		machine->run(&tempHash);
-		machine->getFinalResult(output, RANDOMX_HASH_SIZE);
 		fesetenv(&fpstate);
 	}
 
 	void randomx_calculate_hash_first(randomx_vm* machine, const void* input, size_t inputSize) {
-		blake2b(machine->tempHash, sizeof(machine->tempHash), input, inputSize, nullptr, 0);
+		randomx::PerfScope perfScope(machine->perf, false);
+		randomx::hashSeed(machine, machine->tempHash, input, inputSize);
 		machine->initScratchpad(machine->tempHash);
 	}
 
 	void randomx_calculate_hash_next(randomx_vm* machine, const void* nextInput, size_t nextInputSize, void* output) {
-		machine->resetRoundingMode();
-		for (uint32_t chain = 0; chain < RANDOMX_PROGRAM_COUNT - 1; ++chain) {
-			machine->run(machine->tempHash);
-			blake2b(machine->tempHash, sizeof(machine->tempHash), machine->getRegisterFile(), sizeof(randomx::RegisterFile), nullptr, 0);
-		}
-		machine->run(machine->tempHash);
+		randomx::PerfScope perfScope(machine->perf, true);
+		randomx::runPrograms(machine, machine->tempHash);
 
 		// Finish current hash and fill the scratchpad for the next hash at the same time
-		blake2b(machine->tempHash, sizeof(machine->tempHash), nextInput, nextInputSize, nullptr, 0);
+		randomx::hashSeed(machine, machine->tempHash, nextInput, nextInputSize);
 		machine->hashAndFill(output, RANDOMX_HASH_SIZE, machine->tempHash);
 	}
 
 	void randomx_calculate_hash_last(randomx_vm* machine, void* output) {
-		machine->resetRoundingMode();
-		for (int chain = 0; chain < RANDOMX_PROGRAM_COUNT - 1; ++chain) {
-			machine->run(machine->tempHash);
-			blake2b(machine->tempHash, sizeof(machine->tempHash), machine->getRegisterFile(), sizeof(randomx::RegisterFile), nullptr, 0);
-		}
-		machine->run(machine->tempHash);
+		randomx::PerfScope perfScope(machine->perf, true);
+		randomx::runPrograms(machine, machine->tempHash);
 		machine->getFinalResult(output, RANDOMX_HASH_SIZE);
 	}
+
+	void randomx_calculate_hash_batch(randomx_vm *machine, const void * const *inputs, const size_t *inputSizes, void * const *outputs, unsigned count) {
+		assert(machine != nullptr);
+		assert(count == 0 || (inputs != nullptr && inputSizes != nullptr && outputs != nullptr));
+		if (count == 0)
+			return;
+		fenv_t fpstate;
+		fegetenv(&fpstate);
+		alignas(16) uint64_t tempHash[8];
+		{
+			randomx::PerfScope perfScope(machine->perf, false);
+			assert(inputSizes[0] == 0 || inputs[0] != nullptr);
+			randomx::hashSeed(machine, tempHash, inputs[0], inputSizes[0]);
+			machine->initScratchpad(tempHash);
+		}
+		//the final AES hash of each scratchpad is fused with the fill for the next input
+		for (unsigned i = 1; i < count; ++i) {
+			assert(inputSizes[i] == 0 || inputs[i] != nullptr);
+			assert(outputs[i - 1] != nullptr);
+			randomx::PerfScope perfScope(machine->perf, true);
+			randomx::runPrograms(machine, tempHash);
+			randomx::hashSeed(machine, tempHash, inputs[i], inputSizes[i]);
+			machine->hashAndFill(outputs[i - 1], RANDOMX_HASH_SIZE, tempHash);
+		}
+		assert(outputs[count - 1] != nullptr);
+		randomx::PerfScope perfScope(machine->perf, true);
+		randomx::runPrograms(machine, tempHash);
+		machine->getFinalResult(outputs[count - 1], RANDOMX_HASH_SIZE);
+		fesetenv(&fpstate);
+	}
+
+	int randomx_get_profile(randomx_vm *machine, randomx_profile *profile) {
+		assert(machine != nullptr && profile != nullptr);
+#ifdef RANDOMX_PROFILE
+		const randomx::ProfileCounters& counters = machine->profile;
+		profile->fill_scratchpad = counters.nanoseconds[randomx::ProfileFillScratchpad];
+		profile->generate_program = counters.nanoseconds[randomx::ProfileGenerateProgram];
+		profile->compile = counters.nanoseconds[randomx::ProfileCompile];
+		profile->execute = counters.nanoseconds[randomx::ProfileExecute];
+		profile->blake2b_hash = counters.nanoseconds[randomx::ProfileBlake2b];
+		profile->final_hash = counters.nanoseconds[randomx::ProfileFinalHash];
+		profile->hashes = counters.hashes;
+		return 1;
+#else
+		*profile = {};
+		return 0;
+#endif
+	}
+
+	void randomx_reset_profile(randomx_vm *machine) {
+		assert(machine != nullptr);
+#ifdef RANDOMX_PROFILE
+		machine->profile = {};
+#endif
+	}
+
+	int randomx_vm_enable_perf_counters(randomx_vm *machine) {
+		assert(machine != nullptr);
+		if (machine->perf == nullptr) {
+			auto perf = new randomx::PerfCounters();
+			if (perf->available() == 0) {
+				delete perf;
+				return 0;
+			}
+			machine->perf = perf;
+		}
+		return machine->perf->available();
+	}
+
+	int randomx_vm_get_perf_counters(randomx_vm *machine, randomx_perf_counters *counters) {
+		assert(machine != nullptr && counters != nullptr);
+		if (machine->perf == nullptr)
+			return 0;
+		machine->perf->read(counters);
+		return 1;
+	}
+
+	void randomx_vm_reset_perf_counters(randomx_vm *machine) {
+		assert(machine != nullptr);
+		if (machine->perf != nullptr)
+			machine->perf->reset();
+	}
+
+	randomx_engine *randomx_create_engine(randomx_flags flags, unsigned threads, unsigned maxKeys) {
+		try {
+			return new randomx_engine(flags, threads, maxKeys);
+		}
+		catch (std::exception&) {
+			return nullptr;
+		}
+	}
+
+	int randomx_engine_submit(randomx_engine *engine, const void *key, size_t keySize, const void *input, size_t inputSize, uint64_t userData) {
+		assert(engine != nullptr);
+		assert(keySize == 0 || key != nullptr);
+		assert(inputSize == 0 || input != nullptr);
+		try {
+			engine->submit(key, keySize, input, inputSize, userData);
+			return 1;
+		}
+		catch (std::bad_alloc&) {
+			return 0;
+		}
+	}
+
+	unsigned randomx_engine_poll(randomx_engine *engine, randomx_engine_result *results, unsigned maxResults) {
+		assert(engine != nullptr);
+		assert(maxResults == 0 || results != nullptr);
+		return engine->poll(results, maxResults);
+	}
+
+	unsigned randomx_engine_wait(randomx_engine *engine, randomx_engine_result *results, unsigned maxResults, unsigned timeoutMs) {
+		assert(engine != nullptr);
+		assert(maxResults == 0 || results != nullptr);
+		return engine->wait(results, maxResults, timeoutMs);
+	}
+
+	int randomx_engine_fd(randomx_engine *engine) {
+		assert(engine != nullptr);
+		return engine->fd();
+	}
+
+	void randomx_destroy_engine(randomx_engine *engine) {
+		delete engine;
+	}
+
+	void randomx_get_cpu_info(randomx_cpu_info *info) {
+		assert(info != nullptr);
+		static const randomx::Cpu cpu;
+		switch (cpu.vendor()) {
+			case randomx::CpuVendorIntel:
+				info->vendor = RANDOMX_CPU_VENDOR_INTEL;
+				break;
+			case randomx::CpuVendorAmd:
+				info->vendor = RANDOMX_CPU_VENDOR_AMD;
+				break;
+			default:
+				info->vendor = RANDOMX_CPU_VENDOR_UNKNOWN;
+		}
+		info->family = cpu.family();
+		info->model = cpu.model();
+		info->stepping = cpu.stepping();
+		memcpy(info->brand, cpu.brand(), sizeof(info->brand));
+		info->aes = cpu.hasAes();
+		info->ssse3 = cpu.hasSsse3();
+		info->avx2 = cpu.hasAvx2();
+		info->avx512f = cpu.hasAvx512();
+		info->vaes = cpu.hasVaes();
+		info->bmi2 = cpu.hasBmi2();
+		info->l1d_size = cpu.l1dSize();
+		info->l2_size = cpu.l2Size();
+		info->l3_size = cpu.l3Size();
+		info->threads_per_core = cpu.threadsPerCore();
+		info->threads_per_l2 = cpu.threadsPerL2();
+		info->threads_per_l3 = cpu.threadsPerL3();
+		info->logical_cpus = cpu.logicalCpus();
+	}
+
+	int randomx_autotune(randomx_tuning *tuning, randomx_dataset *dataset, unsigned maxThreads, unsigned trialMs) {
+		assert(tuning != nullptr);
+		try {
+			randomx::autotune(tuning, dataset, maxThreads, trialMs);
+			return 1;
+		}
+		catch (std::exception&) {
+			return 0;
+		}
+	}
+
+	int randomx_save_tuning(const char *path, const randomx_tuning *tuning) {
+		assert(tuning != nullptr);
+		return randomx::saveTuning(path != nullptr ? path : randomx::defaultTuningPath(), tuning);
+	}
+
+	int randomx_load_tuning(const char *path, randomx_tuning *tuning) {
+		assert(tuning != nullptr);
+		return randomx::loadTuning(path != nullptr ? path : randomx::defaultTuningPath(), tuning);
+	}
+
+	int randomx_cache_page_info(randomx_cache *cache, randomx_page_info *info) {
+		assert(cache != nullptr && info != nullptr);
+		return getPageInfo(cache->memory, randomx::CacheSize, info);
+	}
+
+	int randomx_dataset_page_info(randomx_dataset *dataset, randomx_page_info *info) {
+		assert(dataset != nullptr && info != nullptr);
+		return getPageInfo(dataset->memory, dataset->getSize(), info);
+	}
+
+	int randomx_scratchpad_page_info(randomx_vm *machine, randomx_page_info *info) {
+		assert(machine != nullptr && info != nullptr);
+		return getPageInfo(machine->getScratchpad(), randomx::ScratchpadSize, info);
+	}
 }
@@ -48,12 +48,102 @@ typedef enum {
   RANDOMX_FLAG_SECURE = 16,
   RANDOMX_FLAG_ARGON2_SSSE3 = 32,
   RANDOMX_FLAG_ARGON2_AVX2 = 64,
-  RANDOMX_FLAG_ARGON2 = 96
+  RANDOMX_FLAG_ARGON2 = 96,
+  RANDOMX_FLAG_BITSLICE_AES = 128,
+  RANDOMX_FLAG_SCRATCHPAD_ARENA = 256,
+  RANDOMX_FLAG_FIRST_TOUCH = 512
 } randomx_flags;
 
+/* software prefetch of the next dataset item (full mode) or its first cache block (light mode JIT) */
+typedef enum {
+  RANDOMX_PREFETCH_NTA = 0,  /* prefetchnta (default) */
+  RANDOMX_PREFETCH_T0 = 1,   /* prefetcht0 */
+  RANDOMX_PREFETCH_T1 = 2,   /* prefetcht1 */
+  RANDOMX_PREFETCH_T2 = 3,   /* prefetcht2 */
+  RANDOMX_PREFETCH_NONE = 4, /* no software prefetch */
+  RANDOMX_PREFETCH_MODES = 5,
+} randomx_prefetch_mode;
+
 typedef struct randomx_dataset randomx_dataset;
 typedef struct randomx_cache randomx_cache;
 typedef struct randomx_vm randomx_vm;
+typedef struct randomx_engine randomx_engine;
+
+typedef struct randomx_page_info {
+  size_t size;           /* size of the memory region in bytes */
+  size_t page_size;      /* largest kernel page size backing the region */
+  size_t hugetlb_bytes;  /* bytes backed by reserved huge pages (hugetlbfs) */
+  size_t thp_bytes;      /* bytes backed by transparent huge pages */
+  size_t resident_bytes; /* bytes currently resident in physical memory */
+} randomx_page_info;
+
+/* cumulative time in nanoseconds spent by a VM in each hashing phase */
+typedef struct randomx_profile {
+  uint64_t fill_scratchpad;  /* AesGenerator1R scratchpad fill */
+  uint64_t generate_program; /* AesGenerator4R program generation */
+  uint64_t compile;          /* JIT compilation or bytecode generation */
+  uint64_t execute;          /* program execution */
+  uint64_t blake2b_hash;     /* Blake2b of the input and of the register file */
+  uint64_t final_hash;       /* AesHash1R of the scratchpad */
+  uint64_t hashes;           /* number of finished hashes */
+} randomx_profile;
+
+#define RANDOMX_PERF_UNAVAILABLE UINT64_MAX
+
+/* hardware events counted while a VM calculates hashes, RANDOMX_PERF_UNAVAILABLE if a counter could not be opened */
+typedef struct randomx_perf_counters {
+  uint64_t cycles;
+  uint64_t instructions;
+  uint64_t l1d_misses;    /* L1 data cache read misses */
+  uint64_t l2_misses;     /* L2 misses (raw event, Intel and AMD only) */
+  uint64_t llc_misses;    /* last level cache read misses */
+  uint64_t dtlb_misses;   /* data TLB read misses */
+  uint64_t branch_misses;
+  uint64_t hashes;        /* number of hashes finished while counting */
+} randomx_perf_counters;
+
+/* deployment parameters measured by randomx_autotune */
+typedef struct randomx_tuning {
+  randomx_flags flags;   /* flags for caches, datasets and VMs (without RANDOMX_FLAG_FULL_MEM) */
+  unsigned threads;      /* number of hashing threads */
+  unsigned init_threads; /* number of dataset initialization threads */
+  uint64_t affinity;     /* thread affinity mask, 0 if threads should not be pinned */
+  double hashrate;       /* hashes per second measured with the selected parameters */
+  int full_mem;          /* 1 if the hashrate was measured with a dataset, 0 in light mode */
+} randomx_tuning;
+
+/* completed job of a randomx_engine */
+typedef struct randomx_engine_result {
+  uint64_t user_data;             /* value passed to randomx_engine_submit */
+  int status;                     /* 1 if hash is valid, 0 if the cache or VM could not be allocated */
+  char hash[RANDOMX_HASH_SIZE];
+} randomx_engine_result;
+
+#define RANDOMX_CPU_VENDOR_UNKNOWN 0
+#define RANDOMX_CPU_VENDOR_INTEL 1
+#define RANDOMX_CPU_VENDOR_AMD 2
+
+/* features and cache topology of the CPU the library runs on */
+typedef struct randomx_cpu_info {
+  int vendor;                /* RANDOMX_CPU_VENDOR_* */
+  unsigned family;           /* family and model including the extended fields, 0 if unknown */
+  unsigned model;
+  unsigned stepping;
+  char brand[49];            /* processor brand string, empty if not reported */
+  int aes;
+  int ssse3;
+  int avx2;
+  int avx512f;
+  int vaes;
+  int bmi2;
+  uint32_t l1d_size;         /* cache sizes in bytes, 0 if unknown */
+  uint32_t l2_size;
+  uint32_t l3_size;
+  unsigned threads_per_core; /* logical CPUs sharing one core (SMT siblings) */
+  unsigned threads_per_l2;   /* logical CPUs sharing one L2 cache, 0 if unknown */
+  unsigned threads_per_l3;   /* logical CPUs sharing one L3 cache, 0 if unknown */
+  unsigned logical_cpus;     /* logical CPUs in the system, 0 if unknown */
+} randomx_cpu_info;
 
 
 #if defined(__cplusplus)
@@ -92,7 +182,8 @@ RANDOMX_EXPORT randomx_flags randomx_get_flags(void);
  * Creates a randomx_cache structure and allocates memory for RandomX Cache.
  *
  * @param flags is any combination of these 2 flags (each flag can be set or not set):
- *        RANDOMX_FLAG_LARGE_PAGES - allocate memory in large pages
+ *        RANDOMX_FLAG_LARGE_PAGES - allocate memory in large pages (on Linux, transparent
+ *                                   huge pages are used if no huge pages are reserved)
  *        RANDOMX_FLAG_JIT - create cache structure with JIT compilation support; this makes
  *                           subsequent Dataset initialization faster
  *        Optionally, one of these two flags may be selected:
@@ -119,6 +210,16 @@ RANDOMX_EXPORT randomx_cache *randomx_alloc_cache(randomx_flags flags);
 */
 RANDOMX_EXPORT void randomx_init_cache(randomx_cache *cache, const void *key, size_t keySize);
 
+/**
+ * Sets the number of threads used to fill the Argon2 lanes during cache initialization.
+ * Only has an effect if the configuration uses more than one lane (RANDOMX_ARGON_LANES > 1).
+ *
+ * @param cache is a pointer to a previously allocated randomx_cache structure. Must not be NULL.
+ * @param threads is the number of threads (capped at the number of lanes). 0 (the default)
+ *        uses one thread per lane, up to the number of hardware threads.
+*/
+RANDOMX_EXPORT void randomx_cache_set_init_threads(randomx_cache *cache, unsigned threads);
+
 /**
  * Releases all memory occupied by the randomx_cache structure.
  *
@@ -129,14 +230,95 @@ RANDOMX_EXPORT void randomx_release_cache(randomx_cache* cache);
 /**
  * Creates a randomx_dataset structure and allocates memory for RandomX Dataset.
  *
- * @param flags is the initialization flags. Only one flag is supported (can be set or not set):
- *        RANDOMX_FLAG_LARGE_PAGES - allocate memory in large pages
+ * @param flags is the initialization flags. Two flags are supported (each can be set or not set):
+ *        RANDOMX_FLAG_LARGE_PAGES - allocate memory in large pages (on Linux, transparent
+ *                                   huge pages are used if no huge pages are reserved)
+ *        RANDOMX_FLAG_FIRST_TOUCH - with RANDOMX_FLAG_LARGE_PAGES, don't prefault the memory when
+ *                                   it is allocated. Pages are faulted in by the threads that call
+ *                                   randomx_init_dataset, so allocation is faster and each page is
+ *                                   placed on the NUMA node of the thread that initializes it.
  *
  * @return Pointer to an allocated randomx_dataset structure.
  *         NULL is returned if memory allocation fails.
  */
 RANDOMX_EXPORT randomx_dataset *randomx_alloc_dataset(randomx_flags flags);
 
+/**
+ * Creates a randomx_dataset structure that holds only the first itemCount items of the Dataset.
+ * A virtual machine created with RANDOMX_FLAG_FULL_MEM, a partial dataset and an initialized
+ * cache reads the precomputed items from the dataset and computes the remaining items from
+ * the cache like a light VM, so the hashrate scales with the size of the partial dataset.
+ * Hashes are the same as in the other modes.
+ *
+ * @param flags is the initialization flags. Same as for randomx_alloc_dataset.
+ * @param itemCount is the number of items to allocate. Memory usage is
+ *        itemCount * RANDOMX_DATASET_ITEM_SIZE bytes. Must be between 1 and
+ *        randomx_dataset_item_count().
+ *
+ * @return Pointer to an allocated randomx_dataset structure.
+ *         NULL is returned if memory allocation fails or if itemCount is out of range.
+ */
+RANDOMX_EXPORT randomx_dataset *randomx_alloc_dataset_partial(randomx_flags flags, unsigned long itemCount);
+
+/**
+ * Creates a randomx_dataset structure backed by a named shared memory object, or attaches
+ * to an existing one, so that several processes on the same host share one copy of the
+ * Dataset. The object is created in hugetlbfs (/dev/hugepages) or as POSIX shared memory
+ * and persists until randomx_unlink_dataset_shared is called. Only supported on POSIX systems.
+ *
+ * Use randomx_begin_dataset_init and randomx_end_dataset_init to decide which process
+ * initializes the Dataset.
+ *
+ * @param name is the name of the shared object. Must not be empty or contain '/'.
+ * @param flags is the initialization flags. Only RANDOMX_FLAG_LARGE_PAGES is supported
+ *        (a new object is created in hugetlbfs if enough huge pages are reserved, otherwise
+ *        transparent huge pages are requested for the shared memory object).
+ *
+ * @return Pointer to an allocated randomx_dataset structure.
+ *         NULL is returned if the object cannot be created or mapped, or if it was created
+ *         with a different RandomX configuration (any parameter that affects the Dataset).
+ */
+RANDOMX_EXPORT randomx_dataset *randomx_alloc_dataset_shared(const char *name, randomx_flags flags);
+
+/**
+ * Removes the shared memory object created by randomx_alloc_dataset_shared. Processes that
+ * have it mapped can keep using it.
+ *
+ * @return 1 if the object was removed, 0 otherwise.
+ */
+RANDOMX_EXPORT int randomx_unlink_dataset_shared(const char *name);
+
+/**
+ * Claims the initialization of a Dataset for the given key.
+ * For a shared Dataset, only one process fills the Dataset: if another process is
+ * initializing it, the call waits until it has finished (or has exited), and returns 0
+ * if the Dataset already holds the items for the key. Otherwise the caller becomes
+ * the owner, must initialize all items with randomx_init_dataset and then call
+ * randomx_end_dataset_init.
+ * A process that got 0 (or finished the initialization) uses the Dataset until it calls
+ * this function again or releases the Dataset. Switching to another key waits until all
+ * other processes have stopped using the old contents in this way, so a Dataset is never
+ * rewritten while another process is hashing from it. This wait is limited to 5 seconds,
+ * because other processes cannot claim the Dataset meanwhile. If it expires, -1 is returned
+ * and the caller should use a private Dataset allocated with randomx_alloc_dataset.
+ * A Dataset allocated with randomx_alloc_dataset must always be initialized.
+ *
+ * @param dataset is a pointer to a previously allocated randomx_dataset structure. Must not be NULL.
+ * @param key is a pointer to memory which contains the key used to initialize the cache.
+ * @param keySize is the number of bytes of the key.
+ *
+ * @return 1 if the caller must initialize the Dataset, 0 if it is ready, -1 if another
+ *         process still uses the Dataset with a different key.
+ */
+RANDOMX_EXPORT int randomx_begin_dataset_init(randomx_dataset *dataset, const void *key, size_t keySize);
+
+/**
+ * Marks a Dataset claimed with randomx_begin_dataset_init as ready for other processes.
+ *
+ * @param dataset is a pointer to a previously allocated randomx_dataset structure. Must not be NULL.
+ */
+RANDOMX_EXPORT void randomx_end_dataset_init(randomx_dataset *dataset);
+
 /**
  * Gets the number of items contained in the dataset.
  *
@@ -147,8 +329,9 @@ RANDOMX_EXPORT unsigned long randomx_dataset_item_count(void);
 /**
  * Initializes dataset items.
  *
- * Note: In order to use the Dataset, all items from 0 to (randomx_dataset_item_count() - 1) must be initialized.
- * This may be done by several calls to this function using non-overlapping item sequences.
+ * Note: In order to use the Dataset, all items from 0 to (randomx_dataset_item_count() - 1) must be initialized
+ * (for a partial dataset, all items it holds). This may be done by several calls to this function using
+ * non-overlapping item sequences.
  *
  * @param dataset is a pointer to a previously allocated randomx_dataset structure. Must not be NULL.
  * @param cache is a pointer to a previously allocated and initialized randomx_cache structure. Must not be NULL.
@@ -157,6 +340,53 @@ RANDOMX_EXPORT unsigned long randomx_dataset_item_count(void);
 */
 RANDOMX_EXPORT void randomx_init_dataset(randomx_dataset *dataset, randomx_cache *cache, unsigned long startItem, unsigned long itemCount);
 
+/**
+ * Initializes the dataset in the background so that it can be used immediately.
+ * The dataset memory is registered with userfaultfd: pages that are read before they
+ * have been initialized are computed on demand, while threadCount threads initialize
+ * the remaining pages in order. Hashing starts at a reduced rate and reaches full
+ * speed when the dataset is complete. Only supported on Linux.
+ *
+ * The cache must not be released or reinitialized until the dataset is ready, and the
+ * dataset must not be released while it is being used by a virtual machine.
+ *
+ * @param dataset is a pointer to a randomx_dataset structure allocated with
+ *        randomx_alloc_dataset. Must not be NULL.
+ * @param cache is a pointer to an initialized randomx_cache structure. Must not be NULL.
+ * @param threadCount is the number of background threads. If 0, pages are only
+ *        initialized when they are accessed or by randomx_wait_dataset.
+ *
+ * @return 1 on success, 0 if lazy initialization is not available (for example,
+ *         for a dataset in 1 GB pages). In that case, the dataset must be
+ *         initialized with randomx_init_dataset.
+*/
+RANDOMX_EXPORT int randomx_init_dataset_lazy(randomx_dataset *dataset, randomx_cache *cache, unsigned threadCount);
+
+/**
+ * Checks if a dataset initialized with randomx_init_dataset_lazy is complete.
+ * For a shared Dataset, also checks that it still holds the contents this process
+ * got from randomx_begin_dataset_init or randomx_end_dataset_init.
+ *
+ * @param dataset is a pointer to a randomx_dataset structure. Must not be NULL.
+ *
+ * @return 1 if all dataset items have been initialized, 0 otherwise.
+*/
+RANDOMX_EXPORT int randomx_dataset_ready(randomx_dataset *dataset);
+
+/**
+ * Waits until a dataset initialized with randomx_init_dataset_lazy is complete and
+ * stops the background threads. The cache can be released afterwards.
+ * If randomx_init_dataset_lazy was called with threadCount = 0, the calling thread
+ * initializes the remaining pages.
+ *
+ * @param dataset is a pointer to a randomx_dataset structure. Must not be NULL.
+ *
+ * @return 1 on success. 0 if userfaultfd failed during the initialization and the
+ *         remaining pages were initialized in place. The dataset is complete in that
+ *         case, but hashes calculated before this function returned may be invalid.
+*/
+RANDOMX_EXPORT int randomx_wait_dataset(randomx_dataset *dataset);
+
 /**
  * Returns a pointer to the internal memory buffer of the dataset structure. The size
  * of the internal memory buffer is randomx_dataset_item_count() * RANDOMX_DATASET_ITEM_SIZE.
@@ -177,20 +407,29 @@ RANDOMX_EXPORT void randomx_release_dataset(randomx_dataset *dataset);
 /**
  * Creates and initializes a RandomX virtual machine.
  *
- * @param flags is any combination of these 5 flags (each flag can be set or not set):
+ * @param flags is any combination of these 7 flags (each flag can be set or not set):
  *        RANDOMX_FLAG_LARGE_PAGES - allocate scratchpad memory in large pages
  *        RANDOMX_FLAG_HARD_AES - virtual machine will use hardware accelerated AES
+ *        RANDOMX_FLAG_BITSLICE_AES - without RANDOMX_FLAG_HARD_AES, virtual machine will use
+ *                                    constant-time bitsliced software AES instead of lookup tables.
+ *                                    This is a side-channel protection, not a performance option:
+ *                                    it is several times slower than the lookup tables.
  *        RANDOMX_FLAG_FULL_MEM - virtual machine will use the full dataset
  *        RANDOMX_FLAG_JIT - virtual machine will use a JIT compiler
  *        RANDOMX_FLAG_SECURE - when combined with RANDOMX_FLAG_JIT, the JIT pages are never
  *                              writable and executable at the same time (W^X policy)
+ *        RANDOMX_FLAG_SCRATCHPAD_ARENA - when combined with RANDOMX_FLAG_JIT and RANDOMX_FLAG_LARGE_PAGES,
+ *                                        scratchpads of all VMs are carved out of shared large-page
+ *                                        regions that grow with the number of VMs (1 GiB pages
+ *                                        if available once a region would take at least 512 MiB)
  *        The numeric values of the first 4 flags are ordered so that a higher value will provide
  *        faster hash calculation and a lower numeric value will provide higher portability.
  *        Using RANDOMX_FLAG_DEFAULT (all flags not set) works on all platforms, but is the slowest.
  * @param cache is a pointer to an initialized randomx_cache structure. Can be
  *        NULL if RANDOMX_FLAG_FULL_MEM is set.
  * @param dataset is a pointer to a randomx_dataset structure. Can be NULL
- *        if RANDOMX_FLAG_FULL_MEM is not set.
+ *        if RANDOMX_FLAG_FULL_MEM is not set. If it was allocated with
+ *        randomx_alloc_dataset_partial, the cache must not be NULL.
  *
  * @return Pointer to an initialized randomx_vm structure.
  *         Returns NULL if:
@@ -198,6 +437,7 @@ RANDOMX_EXPORT void randomx_release_dataset(randomx_dataset *dataset);
  *         (2) The requested initialization flags are not supported on the current platform.
  *         (3) cache parameter is NULL and RANDOMX_FLAG_FULL_MEM is not set
  *         (4) dataset parameter is NULL and RANDOMX_FLAG_FULL_MEM is set
+ *         (5) dataset is a partial dataset and cache parameter is NULL
 */
 RANDOMX_EXPORT randomx_vm *randomx_create_vm(randomx_flags flags, randomx_cache *cache, randomx_dataset *dataset);
 
@@ -221,6 +461,19 @@ RANDOMX_EXPORT void randomx_vm_set_cache(randomx_vm *machine, randomx_cache* cac
 */
 RANDOMX_EXPORT void randomx_vm_set_dataset(randomx_vm *machine, randomx_dataset *dataset);
 
+/**
+ * Selects how a full-mode virtual machine prefetches the dataset item of the next
+ * iteration. In light mode with RANDOMX_FLAG_JIT, it selects how the first cache block
+ * of the next item is prefetched; this prefetch is emitted by default and
+ * RANDOMX_PREFETCH_NONE restores the light-mode code without it. The best mode depends
+ * on the microarchitecture; hash values do not depend on it. Has no effect on
+ * interpreted light-mode machines.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+ * @param mode is one of the randomx_prefetch_mode values.
+*/
+RANDOMX_EXPORT void randomx_vm_set_prefetch_mode(randomx_vm *machine, randomx_prefetch_mode mode);
+
 /**
  * Releases all memory occupied by the randomx_vm structure.
  *
@@ -228,6 +481,16 @@ RANDOMX_EXPORT void randomx_vm_set_dataset(randomx_vm *machine, randomx_dataset
 */
 RANDOMX_EXPORT void randomx_destroy_vm(randomx_vm *machine);
 
+/**
+ * Sets the number of cache colours used by RANDOMX_FLAG_SCRATCHPAD_ARENA. Consecutive scratchpads
+ * are offset by 256-byte steps so that they don't map to the same cache sets. With more than one
+ * colour, each scratchpad takes a 4 MiB slot. Applies to VMs created afterwards. The default is 1
+ * (all scratchpads 2 MiB aligned), the maximum is 16.
+ *
+ * @param colours is the number of different offsets.
+*/
+RANDOMX_EXPORT void randomx_set_scratchpad_colours(unsigned colours);
+
 /**
  * Calculates a RandomX hash value.
  *
@@ -239,6 +502,22 @@ RANDOMX_EXPORT void randomx_destroy_vm(randomx_vm *machine);
 */
 RANDOMX_EXPORT void randomx_calculate_hash(randomx_vm *machine, const void *input, size_t inputSize, void *output);
 
+/**
+ * Calculates RandomX hash values of several inputs, each with its own VM.
+ * On CPUs with VAES, the scratchpads of 2 or 4 VMs are initialized and hashed
+ * together. The results are identical to calling randomx_calculate_hash
+ * for each VM.
+ *
+ * @param machines is an array of count pointers to distinct randomx_vm structures.
+ * @param inputs is an array of count pointers to memory to be hashed.
+ * @param inputSizes is an array of count input sizes in bytes.
+ * @param outputs is an array of count pointers to memory where the hashes will be
+ *        stored. At least RANDOMX_HASH_SIZE bytes must be available for writing
+ *        at each of them.
+ * @param count is the number of hashes to calculate.
+*/
+RANDOMX_EXPORT void randomx_calculate_hash_multi(randomx_vm **machines, const void * const *inputs, const size_t *inputSizes, void * const *outputs, unsigned count);
+
 /**
  * Set of functions used to calculate multiple RandomX hashes more efficiently.
  * randomx_calculate_hash_first will begin a hash calculation.
@@ -260,6 +539,169 @@ RANDOMX_EXPORT void randomx_calculate_hash_first(randomx_vm* machine, const void
 RANDOMX_EXPORT void randomx_calculate_hash_next(randomx_vm* machine, const void* nextInput, size_t nextInputSize, void* output);
 RANDOMX_EXPORT void randomx_calculate_hash_last(randomx_vm* machine, void* output);
 
+/**
+ * Calculates RandomX hash values of several inputs with one VM. The final hash of each
+ * input is computed together with the scratchpad initialization of the next one, as with
+ * randomx_calculate_hash_first/next/last, and the floating point environment is saved and
+ * restored once per batch. The results are identical to calling randomx_calculate_hash
+ * for each input.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+ * @param inputs is an array of count pointers to memory to be hashed.
+ * @param inputSizes is an array of count input sizes in bytes.
+ * @param outputs is an array of count pointers to memory where the hashes will be
+ *        stored. At least RANDOMX_HASH_SIZE bytes must be available for writing
+ *        at each of them.
+ * @param count is the number of hashes to calculate.
+*/
+RANDOMX_EXPORT void randomx_calculate_hash_batch(randomx_vm *machine, const void * const *inputs, const size_t *inputSizes, void * const *outputs, unsigned count);
+
+/**
+ * Reports the pages that actually back the memory of a cache, dataset or VM scratchpad.
+ * With RANDOMX_FLAG_LARGE_PAGES, memory may be backed by reserved huge pages, by
+ * transparent huge pages (when no huge pages are reserved) or partially by small pages.
+ * Currently only supported on Linux (uses /proc/self/smaps). Values are approximate
+ * if the memory shares a mapping with other allocations.
+ *
+ * @param info is a pointer to a randomx_page_info structure that will be filled. Must not be NULL.
+ *
+ * @return 1 on success, 0 if the information is not available.
+*/
+RANDOMX_EXPORT int randomx_cache_page_info(randomx_cache *cache, randomx_page_info *info);
+RANDOMX_EXPORT int randomx_dataset_page_info(randomx_dataset *dataset, randomx_page_info *info);
+RANDOMX_EXPORT int randomx_scratchpad_page_info(randomx_vm *machine, randomx_page_info *info);
+
+/**
+ * Reads the phase timings accumulated by a VM since it was created or last reset.
+ * Timings are only collected when the library is built with RANDOMX_PROFILE
+ * (CMake option PROFILE); otherwise hashing has no instrumentation overhead.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+ * @param profile is a pointer to a randomx_profile structure that will be filled. Must not be NULL.
+ *
+ * @return 1 on success, 0 if the library was built without profiling (profile is zeroed).
+*/
+RANDOMX_EXPORT int randomx_get_profile(randomx_vm *machine, randomx_profile *profile);
+
+/**
+ * Clears the phase timings of a VM.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+*/
+RANDOMX_EXPORT void randomx_reset_profile(randomx_vm *machine);
+
+/**
+ * Opens hardware performance counters (Linux perf events) for the calling thread and
+ * enables them only while this VM is calculating hashes. The VM must then be used by
+ * the same thread. Counters that cannot be opened (no PMU, perf_event_paranoid,
+ * unsupported CPU) are reported as RANDOMX_PERF_UNAVAILABLE.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+ *
+ * @return the number of counters that could be opened. If 0, the VM is not instrumented.
+*/
+RANDOMX_EXPORT int randomx_vm_enable_perf_counters(randomx_vm *machine);
+
+/**
+ * Reads the counters enabled by randomx_vm_enable_perf_counters.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+ * @param counters is a pointer to a randomx_perf_counters structure that will be filled. Must not be NULL.
+ *
+ * @return 1 on success, 0 if the VM has no counters.
+*/
+RANDOMX_EXPORT int randomx_vm_get_perf_counters(randomx_vm *machine, randomx_perf_counters *counters);
+
+/**
+ * Resets the counters enabled by randomx_vm_enable_perf_counters to zero.
+ *
+ * @param machine is a pointer to a randomx_vm structure. Must not be NULL.
+*/
+RANDOMX_EXPORT void randomx_vm_reset_perf_counters(randomx_vm *machine);
+
+/**
+ * Creates a hashing engine for verifiers. The engine owns worker threads with one light-mode
+ * VM each and hashes jobs submitted from any thread without blocking the submitter. Jobs
+ * with the same key are batched on VMs that already use that key, and the caches of the
+ * most recently used keys are kept.
+ *
+ * @param flags are the flags for caches and VMs. RANDOMX_FLAG_FULL_MEM is ignored.
+ * @param threads is the number of worker threads (at least 1).
+ * @param maxKeys is the number of key caches (256 MiB each) to keep when idle (at least 1).
+ *
+ * @return Pointer to a new engine or NULL if the threads could not be started.
+*/
+RANDOMX_EXPORT randomx_engine *randomx_create_engine(randomx_flags flags, unsigned threads, unsigned maxKeys);
+
+/**
+ * Queues the hash of input under key. The key and input are copied.
+ *
+ * @param engine is a pointer to a randomx_engine. Must not be NULL.
+ * @param userData is returned with the result to identify the job.
+ *
+ * @return 1 on success, 0 if memory could not be allocated.
+*/
+RANDOMX_EXPORT int randomx_engine_submit(randomx_engine *engine, const void *key, size_t keySize, const void *input, size_t inputSize, uint64_t userData);
+
+/**
+ * Takes completed jobs from the completion queue, in completion order.
+ * randomx_engine_poll returns immediately; randomx_engine_wait waits up to timeoutMs
+ * milliseconds for at least one result.
+ *
+ * @return the number of results stored in the results array (at most maxResults).
+*/
+RANDOMX_EXPORT unsigned randomx_engine_poll(randomx_engine *engine, randomx_engine_result *results, unsigned maxResults);
+RANDOMX_EXPORT unsigned randomx_engine_wait(randomx_engine *engine, randomx_engine_result *results, unsigned maxResults, unsigned timeoutMs);
+
+/**
+ * @return a file descriptor that is readable while results are queued, for use with
+ *         poll/epoll, or -1 if not supported (Linux eventfd only). Do not read or close it.
+*/
+RANDOMX_EXPORT int randomx_engine_fd(randomx_engine *engine);
+
+/**
+ * Stops the workers and releases the engine. Queued jobs are discarded.
+*/
+RANDOMX_EXPORT void randomx_destroy_engine(randomx_engine *engine);
+
+/**
+ * Describes the CPU: vendor, family/model, the instruction set extensions RandomX can use,
+ * cache sizes and how many logical CPUs share each core and cache. The values come from
+ * CPUID and, on Linux, sysfs.
+ *
+ * @param info is a pointer to a randomx_cpu_info structure that will be filled. Must not be NULL.
+*/
+RANDOMX_EXPORT void randomx_get_cpu_info(randomx_cpu_info *info);
+
+/**
+ * Runs short timed trials on this machine to select the flags (large pages),
+ * the number of hashing threads and the number of dataset initialization threads.
+ * Takes a few seconds per tried thread count. RANDOMX_FLAG_SECURE is not measured:
+ * W^X only adds a cost per program, so it is set only if a JIT VM cannot be created
+ * without it.
+ *
+ * @param tuning is a pointer to a randomx_tuning structure that will be filled. Must not be NULL.
+ * @param dataset is an initialized dataset for full mode trials. If NULL, hashing is measured
+ *        in light mode, which has similar scaling but a much lower hashrate.
+ * @param maxThreads is the maximum number of threads to try, 0 for the number of logical CPUs.
+ * @param trialMs is the duration of each hashing trial in milliseconds.
+ *
+ * @return 1 on success, 0 if memory could not be allocated.
+*/
+RANDOMX_EXPORT int randomx_autotune(randomx_tuning *tuning, randomx_dataset *dataset, unsigned maxThreads, unsigned trialMs);
+
+/**
+ * Stores or loads a tuning profile. A profile file can hold the results of several hosts,
+ * keyed by CPU model and memory size; only the entry of the current host is loaded or replaced.
+ *
+ * @param path is the profile file. If NULL, $RANDOMX_TUNING or ~/.randomx-tuning is used.
+ * @param tuning is a pointer to a randomx_tuning structure. Must not be NULL.
+ *
+ * @return 1 on success, 0 if the file cannot be written or has no entry for this host.
+*/
+RANDOMX_EXPORT int randomx_save_tuning(const char *path, const randomx_tuning *tuning);
+RANDOMX_EXPORT int randomx_load_tuning(const char *path, randomx_tuning *tuning);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -362,3 +362,305 @@ rx_vec_i128 soft_aesdec(rx_vec_i128 in, rx_vec_i128 key) {
 
 	return rx_xor_vec_i128(out, key);
 }
+
+/*
+	Constant-time bitsliced AES rounds on 4 blocks at once.
+
+	The 64 bytes of 4 consecutive blocks are stored as 8 bit planes: bit b of
+	byte i of block k is bit (16 * k + i) of q[b]. The S-box is evaluated with
+	the Boyar-Peralta circuit and ShiftRows/MixColumns become shifts within
+	the 16-bit block fields, so no memory access depends on the data.
+*/
+
+//transpose the 8x8 bit matrix of every word
+static inline void transposeBits(uint64_t (&q)[8]) {
+	for (int i = 0; i < 8; ++i) {
+		uint64_t x = q[i], t;
+		t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AA;
+		x = x ^ t ^ (t << 7);
+		t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCC;
+		x = x ^ t ^ (t << 14);
+		t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0;
+		x = x ^ t ^ (t << 28);
+		q[i] = x;
+	}
+}
+
+//transpose the 8x8 byte matrix formed by the words
+static inline void transposeBytes(uint64_t (&q)[8]) {
+	for (int s = 1; s < 8; s <<= 1) {
+		const int shift = 8 * s;
+		const uint64_t mask = s == 1 ? 0x00FF00FF00FF00FF : (s == 2 ? 0x0000FFFF0000FFFF : 0x00000000FFFFFFFF);
+		for (int i = 0; i < 8; ++i) {
+			if (i & s)
+				continue;
+			uint64_t t = ((q[i] >> shift) ^ q[i + s]) & mask;
+			q[i + s] ^= t;
+			q[i] ^= t << shift;
+		}
+	}
+}
+
+void soft_aes_bitslice(uint64_t (&q)[8], const void* blocks) {
+	for (int i = 0; i < 8; ++i)
+		q[i] = load64((const uint8_t*)blocks + 8 * i);
+	transposeBits(q);
+	transposeBytes(q);
+}
+
+void soft_aes_unbitslice(void* blocks, const uint64_t (&q)[8]) {
+	uint64_t x[8];
+	for (int i = 0; i < 8; ++i)
+		x[i] = q[i];
+	transposeBytes(x);
+	transposeBits(x);
+	for (int i = 0; i < 8; ++i)
+		store64((uint8_t*)blocks + 8 * i, x[i]);
+}
+
+static inline void bitsliceSbox(uint64_t (&q)[8]) {
+	uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+	uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	uint64_t y20, y21;
+	uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+	uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+	uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	//top linear transformation
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9 = x0 ^ x3;
+	y8 = x0 ^ x5;
+	t0 = x1 ^ x2;
+	y1 = t0 ^ x7;
+	y4 = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2 = y1 ^ x0;
+	y5 = y1 ^ x6;
+	y3 = y5 ^ y8;
+	t1 = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6 = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7 = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	//non-linear section
+	t2 = y12 & y15;
+	t3 = y3 & y6;
+	t4 = t3 ^ t2;
+	t5 = y4 & x7;
+	t6 = t5 ^ t2;
+	t7 = y13 & y16;
+	t8 = y5 & y1;
+	t9 = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0 = t44 & y15;
+	z1 = t37 & y6;
+	z2 = t33 & x7;
+	z3 = t43 & y16;
+	z4 = t40 & y1;
+	z5 = t29 & y7;
+	z6 = t42 & y11;
+	z7 = t45 & y17;
+	z8 = t41 & y10;
+	z9 = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	//bottom linear transformation
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0 = t59 ^ t63;
+	s6 = t56 ^ ~t62;
+	s7 = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3 = t53 ^ t66;
+	s4 = t51 ^ t66;
+	s5 = t47 ^ t65;
+	s1 = t64 ^ ~s3;
+	s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+//Inverse of the S-box affine transformation, applied only to the bits in 'mask'.
+//The inverse S-box is this transformation, then the S-box, then this transformation again.
+static inline void bitsliceInvAffine(uint64_t (&q)[8], uint64_t mask) {
+	uint64_t q0, q1, q2, q3, q4, q5, q6, q7;
+	q0 = q[0] ^ mask;
+	q1 = q[1] ^ mask;
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = q[5] ^ mask;
+	q6 = q[6] ^ mask;
+	q7 = q[7];
+	q[7] ^= (q1 ^ q4 ^ q6 ^ q[7]) & mask;
+	q[6] ^= (q0 ^ q3 ^ q5 ^ q[6]) & mask;
+	q[5] ^= (q7 ^ q2 ^ q4 ^ q[5]) & mask;
+	q[4] ^= (q6 ^ q1 ^ q3 ^ q[4]) & mask;
+	q[3] ^= (q5 ^ q0 ^ q2 ^ q[3]) & mask;
+	q[2] ^= (q4 ^ q7 ^ q1 ^ q[2]) & mask;
+	q[1] ^= (q3 ^ q6 ^ q0 ^ q[1]) & mask;
+	q[0] ^= (q2 ^ q5 ^ q7 ^ q[0]) & mask;
+}
+
+//rotate right by 'bits' within each 16-bit block field
+static inline uint64_t rotrBlock(uint64_t x, int bits) {
+	const uint64_t low = (0xFFFFULL >> bits) * 0x0001000100010001ULL;
+	return ((x >> bits) & low) | ((x << (16 - bits)) & ~low);
+}
+
+//rotate the rows of every column (the 4 bits of every nibble) by 'rows'
+static inline uint64_t rotrRows(uint64_t x, int rows) {
+	const uint64_t low = (0xFULL >> rows) * 0x1111111111111111ULL;
+	return ((x >> rows) & low) | ((x << (4 - rows)) & ~low);
+}
+
+void soft_aes_round_bitsliced(uint64_t (&q)[8], const uint64_t (&key)[8], uint64_t decMask) {
+	constexpr uint64_t row0 = 0x1111111111111111ULL;
+	constexpr uint64_t row1 = row0 << 1;
+	constexpr uint64_t row2 = row0 << 2;
+	constexpr uint64_t row3 = row0 << 3;
+	const uint64_t encMask = ~decMask;
+
+	//SubBytes (encryption) or InvSubBytes (decryption)
+	bitsliceInvAffine(q, decMask);
+	bitsliceSbox(q);
+	bitsliceInvAffine(q, decMask);
+
+	//ShiftRows rotates row r left by r columns, InvShiftRows right by r columns
+	const uint64_t rotr4 = (row1 & encMask) | (row3 & decMask);
+	const uint64_t rotr12 = (row3 & encMask) | (row1 & decMask);
+	for (int i = 0; i < 8; ++i) {
+		uint64_t x = q[i];
+		q[i] = (x & row0) | rotrBlock(x & rotr4, 4) | rotrBlock(x & row2, 8) | rotrBlock(x & rotr12, 12);
+	}
+
+	//InvMixColumns is MixColumns preceded by a[i] ^= 4 * (a[i] ^ a[i + 2])
+	uint64_t u[8];
+	for (int i = 0; i < 8; ++i)
+		u[i] = (q[i] ^ rotrRows(q[i], 2)) & decMask;
+	uint64_t u4[8]; //u * 4
+	u4[0] = u[6];
+	u4[1] = u[6] ^ u[7];
+	u4[2] = u[0] ^ u[7];
+	u4[3] = u[1] ^ u[6];
+	u4[4] = u[2] ^ u[6] ^ u[7];
+	u4[5] = u[3] ^ u[7];
+	u4[6] = u[4];
+	u4[7] = u[5];
+	for (int i = 0; i < 8; ++i)
+		q[i] ^= u4[i];
+
+	//MixColumns: a'[i] = 2 * (a[i] ^ a[i + 1]) ^ a[i + 1] ^ a[i + 2] ^ a[i + 3]
+	uint64_t d[8], r1[8];
+	for (int i = 0; i < 8; ++i) {
+		r1[i] = rotrRows(q[i], 1);
+		d[i] = q[i] ^ r1[i];
+	}
+	uint64_t d2[8]; //d * 2
+	d2[0] = d[7];
+	d2[1] = d[0] ^ d[7];
+	d2[2] = d[1];
+	d2[3] = d[2] ^ d[7];
+	d2[4] = d[3] ^ d[7];
+	d2[5] = d[4];
+	d2[6] = d[5];
+	d2[7] = d[6];
+	for (int i = 0; i < 8; ++i)
+		q[i] = d2[i] ^ r1[i] ^ rotrRows(d[i], 2) ^ key[i];
+}
@@ -35,6 +35,18 @@ rx_vec_i128 soft_aesenc(rx_vec_i128 in, rx_vec_i128 key);
 
 rx_vec_i128 soft_aesdec(rx_vec_i128 in, rx_vec_i128 key);
 
+//Constant-time bitsliced AES: 4 consecutive 16-byte blocks are converted to/from
+//8 bit planes and one round (aesenc or aesdec per block) is applied to all of them.
+//Bits of 'decMask' select the blocks that use aesdec: 16 bits per block.
+constexpr uint64_t SoftAesDecBlocks02 = 0x0000FFFF0000FFFF;
+constexpr uint64_t SoftAesDecBlocks13 = 0xFFFF0000FFFF0000;
+
+void soft_aes_bitslice(uint64_t (&q)[8], const void* blocks);
+
+void soft_aes_unbitslice(void* blocks, const uint64_t (&q)[8]);
+
+void soft_aes_round_bitsliced(uint64_t (&q)[8], const uint64_t (&key)[8], uint64_t decMask);
+
 template<bool soft>
 inline rx_vec_i128 aesenc(rx_vec_i128 in, rx_vec_i128 key) {
 	return soft ? soft_aesenc(in, key) : rx_aesenc_vec_i128(in, key);
@@ -900,4 +900,204 @@ namespace randomx {
 			}
 		}
 	}
+
+	//Superscalar programs lowered to bytecode. Instructions are resolved to one of
+	//the operations below (immediates sign-extended, reciprocals precomputed) and
+	//emitted in pairs, so one dispatch executes two instructions. Dispatch cost,
+	//not arithmetic, dominates interpreted SuperscalarHash.
+	enum SuperscalarBytecodeOp {
+		SSB_ISUB_R,
+		SSB_IXOR_R,
+		SSB_IADD_RS,
+		SSB_IMUL_R,
+		SSB_IMULH_R,
+		SSB_ISMULH_R,
+		SSB_IROR_C,
+		SSB_IADD_C,
+		SSB_IXOR_C,
+		SSB_IMUL_RCP,
+		SSB_NOP,
+		SSB_OPS
+	};
+
+	constexpr uint16_t SuperscalarBytecodeEnd = SSB_IMUL_RCP * SSB_OPS + SSB_OPS;
+
+	static void lowerSuperscalar(Instruction& instr, std::vector<uint64_t> *reciprocals, uint8_t& op, uint8_t& shift, uint64_t& imm) {
+		shift = 0;
+		imm = 0;
+		switch ((SuperscalarInstructionType)instr.opcode)
+		{
+		case SuperscalarInstructionType::ISUB_R:
+			op = SSB_ISUB_R;
+			break;
+		case SuperscalarInstructionType::IXOR_R:
+			op = SSB_IXOR_R;
+			break;
+		case SuperscalarInstructionType::IADD_RS:
+			op = SSB_IADD_RS;
+			shift = instr.getModShift();
+			break;
+		case SuperscalarInstructionType::IMUL_R:
+			op = SSB_IMUL_R;
+			break;
+		case SuperscalarInstructionType::IROR_C:
+			op = SSB_IROR_C;
+			shift = instr.getImm32() & 63;
+			break;
+		case SuperscalarInstructionType::IADD_C7:
+		case SuperscalarInstructionType::IADD_C8:
+		case SuperscalarInstructionType::IADD_C9:
+			op = SSB_IADD_C;
+			imm = signExtend2sCompl(instr.getImm32());
+			break;
+		case SuperscalarInstructionType::IXOR_C7:
+		case SuperscalarInstructionType::IXOR_C8:
+		case SuperscalarInstructionType::IXOR_C9:
+			op = SSB_IXOR_C;
+			imm = signExtend2sCompl(instr.getImm32());
+			break;
+		case SuperscalarInstructionType::IMULH_R:
+			op = SSB_IMULH_R;
+			break;
+		case SuperscalarInstructionType::ISMULH_R:
+			op = SSB_ISMULH_R;
+			break;
+		case SuperscalarInstructionType::IMUL_RCP:
+			op = SSB_IMUL_RCP;
+			imm = reciprocals != nullptr ? (*reciprocals)[instr.getImm32()] : randomx_reciprocal(instr.getImm32());
+			break;
+		default:
+			UNREACHABLE;
+		}
+	}
+
+	void compileSuperscalarBytecode(SuperscalarProgram& prog, std::vector<SuperscalarBytecode>& bytecode, std::vector<uint64_t> *reciprocals) {
+		bytecode.clear();
+		for (unsigned j = 0; j < prog.getSize(); j += 2) {
+			SuperscalarBytecode entry;
+			uint8_t op1, op2 = SSB_NOP;
+			Instruction& first = prog(j);
+			lowerSuperscalar(first, reciprocals, op1, entry.shift1, entry.imm1);
+			entry.dst1 = first.dst;
+			entry.src1 = first.src;
+			entry.dst2 = entry.src2 = entry.shift2 = 0;
+			entry.imm2 = 0;
+			if (j + 1 < prog.getSize()) {
+				Instruction& second = prog(j + 1);
+				lowerSuperscalar(second, reciprocals, op2, entry.shift2, entry.imm2);
+				entry.dst2 = second.dst;
+				entry.src2 = second.src;
+			}
+			entry.handler = op1 * SSB_OPS + op2;
+			bytecode.push_back(entry);
+		}
+		SuperscalarBytecode end = {};
+		end.handler = SuperscalarBytecodeEnd;
+		bytecode.push_back(end);
+	}
+
+	static FORCE_INLINE uint64_t bytecodeRotr(uint64_t a, unsigned b) {
+		return (a >> b) | (a << (-b & 63));
+	}
+
+#if defined(__SIZEOF_INT128__)
+	static FORCE_INLINE uint64_t bytecodeMulh(uint64_t a, uint64_t b) {
+		return ((unsigned __int128)a * b) >> 64;
+	}
+
+	static FORCE_INLINE int64_t bytecodeSmulh(int64_t a, int64_t b) {
+		return ((__int128)a * b) >> 64;
+	}
+#else
+	static FORCE_INLINE uint64_t bytecodeMulh(uint64_t a, uint64_t b) {
+		return mulh(a, b);
+	}
+
+	static FORCE_INLINE int64_t bytecodeSmulh(int64_t a, int64_t b) {
+		return smulh(a, b);
+	}
+#endif
+
+#define SSB_ISUB_R(n) r[ibc->dst ## n] -= r[ibc->src ## n]
+#define SSB_IXOR_R(n) r[ibc->dst ## n] ^= r[ibc->src ## n]
+#define SSB_IADD_RS(n) r[ibc->dst ## n] += r[ibc->src ## n] << ibc->shift ## n
+#define SSB_IMUL_R(n) r[ibc->dst ## n] *= r[ibc->src ## n]
+#define SSB_IMULH_R(n) r[ibc->dst ## n] = bytecodeMulh(r[ibc->dst ## n], r[ibc->src ## n])
+#define SSB_ISMULH_R(n) r[ibc->dst ## n] = bytecodeSmulh(r[ibc->dst ## n], r[ibc->src ## n])
+#define SSB_IROR_C(n) r[ibc->dst ## n] = bytecodeRotr(r[ibc->dst ## n], ibc->shift ## n)
+#define SSB_IADD_C(n) r[ibc->dst ## n] += ibc->imm ## n
+#define SSB_IXOR_C(n) r[ibc->dst ## n] ^= ibc->imm ## n
+#define SSB_IMUL_RCP(n) r[ibc->dst ## n] *= ibc->imm ## n
+#define SSB_NOP(n) (void)0
+
+#define SSB_SECOND(X, a) X(a, ISUB_R) X(a, IXOR_R) X(a, IADD_RS) X(a, IMUL_R) X(a, IMULH_R) X(a, ISMULH_R) \
+	X(a, IROR_C) X(a, IADD_C) X(a, IXOR_C) X(a, IMUL_RCP) X(a, NOP)
+#define SSB_PAIRS(X) SSB_SECOND(X, ISUB_R) SSB_SECOND(X, IXOR_R) SSB_SECOND(X, IADD_RS) SSB_SECOND(X, IMUL_R) \
+	SSB_SECOND(X, IMULH_R) SSB_SECOND(X, ISMULH_R) SSB_SECOND(X, IROR_C) SSB_SECOND(X, IADD_C) \
+	SSB_SECOND(X, IXOR_C) SSB_SECOND(X, IMUL_RCP)
+
+#if defined(__GNUC__)
+
+#define SSB_LABEL(a, b) &&ssb_ ## a ## _ ## b,
+#define SSB_HANDLER(a, b) ssb_ ## a ## _ ## b: \
+	SSB_ ## a(1); \
+	SSB_ ## b(2); \
+	++ibc; \
+	goto *handlers[ibc->handler];
+
+	void executeSuperscalarBytecode(int_reg_t(&r)[8], const SuperscalarBytecode* bytecode) {
+		static const void* const handlers[] = {
+			SSB_PAIRS(SSB_LABEL)
+			&&ssb_END
+		};
+		static_assert(sizeof(handlers) / sizeof(handlers[0]) == SuperscalarBytecodeEnd + 1, "Invalid handler table");
+		const SuperscalarBytecode* ibc = bytecode;
+		goto *handlers[ibc->handler];
+
+		SSB_PAIRS(SSB_HANDLER)
+
+	ssb_END:
+		return;
+	}
+
+#undef SSB_HANDLER
+#undef SSB_LABEL
+
+#else
+
+#define SSB_CASE(a, b) case SSB_ ## a * SSB_OPS + SSB_ ## b: \
+	SSB_ ## a(1); \
+	SSB_ ## b(2); \
+	break;
+
+	void executeSuperscalarBytecode(int_reg_t(&r)[8], const SuperscalarBytecode* bytecode) {
+		for (const SuperscalarBytecode* ibc = bytecode; ; ++ibc) {
+			switch (ibc->handler)
+			{
+			SSB_PAIRS(SSB_CASE)
+			case SuperscalarBytecodeEnd:
+				return;
+			default:
+				UNREACHABLE;
+			}
+		}
+	}
+
+#undef SSB_CASE
+
+#endif
+
+#undef SSB_PAIRS
+#undef SSB_SECOND
+#undef SSB_NOP
+#undef SSB_IMUL_RCP
+#undef SSB_IXOR_C
+#undef SSB_IADD_C
+#undef SSB_IROR_C
+#undef SSB_ISMULH_R
+#undef SSB_IMULH_R
+#undef SSB_IMUL_R
+#undef SSB_IADD_RS
+#undef SSB_IXOR_R
+#undef SSB_ISUB_R
 }
@@ -55,6 +55,15 @@ namespace randomx {
 		INVALID = -1
 	};
 
+	//two superscalar instructions with resolved operands
+	struct SuperscalarBytecode {
+		uint16_t handler;
+		uint8_t dst1, src1, dst2, src2, shift1, shift2;
+		uint64_t imm1, imm2;
+	};
+
 	void generateSuperscalar(SuperscalarProgram& prog, Blake2Generator& gen);
 	void executeSuperscalar(uint64_t(&r)[8], SuperscalarProgram& prog, std::vector<uint64_t> *reciprocals = nullptr);
+	void compileSuperscalarBytecode(SuperscalarProgram& prog, std::vector<SuperscalarBytecode>& bytecode, std::vector<uint64_t> *reciprocals = nullptr);
+	void executeSuperscalarBytecode(uint64_t(&r)[8], const SuperscalarBytecode* bytecode);
 }
\ No newline at end of file
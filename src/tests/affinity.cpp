@@ -28,6 +28,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <tuple>
 
 #if defined(_WIN32) || defined(__CYGWIN__)
   #include <windows.h>
@@ -37,6 +41,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #include <mach/thread_policy.h>
   #endif
   #include <pthread.h>
+  #ifdef __linux__
+    #include <sched.h>
+  #endif
 #endif
 #include "affinity.hpp"
 
@@ -115,3 +122,112 @@ mask_to_string(uint64_t mask)
     }
     return ss.str();
 }
+
+#if defined(__linux__)
+static int
+read_sysfs_int(const std::string &path)
+{
+    std::ifstream file(path);
+    int value = -1;
+    if (!(file >> value))
+        return -1;
+    return value;
+}
+
+static int
+find_l3_domain(unsigned cpuid)
+{
+    std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpuid) + "/cache/index";
+    for (int index = 0; index < 8; ++index)
+    {
+        if (read_sysfs_int(base + std::to_string(index) + "/level") != 3)
+            continue;
+        /* the list starts with the lowest CPU sharing the cache, e.g. "0-7,16-23" */
+        return read_sysfs_int(base + std::to_string(index) + "/shared_cpu_list");
+    }
+    return -1;
+}
+#endif
+
+std::vector<cpu_topology_entry>
+read_cpu_topology()
+{
+    std::vector<cpu_topology_entry> topology;
+#if defined(__linux__) && !defined(__ANDROID__)
+    cpu_set_t cs;
+    CPU_ZERO(&cs);
+    if (sched_getaffinity(0, sizeof(cs), &cs) == 0)
+    {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (!CPU_ISSET(cpu, &cs))
+                continue;
+            std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            cpu_topology_entry entry;
+            entry.cpuid = cpu;
+            entry.package = read_sysfs_int(base + "physical_package_id");
+            entry.core = read_sysfs_int(base + "core_id");
+            entry.l3 = find_l3_domain(cpu);
+            entry.smt_index = 0;
+            if (entry.core < 0)
+                entry.core = cpu;
+            topology.push_back(entry);
+        }
+    }
+#endif
+    if (topology.empty())
+    {
+        unsigned count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < count; ++cpu)
+            topology.push_back({ cpu, 0, (int)cpu, -1, 0 });
+    }
+    std::map<std::pair<int, int>, unsigned> siblings;
+    for (auto &entry : topology)
+        entry.smt_index = siblings[std::make_pair(entry.package, entry.core)]++;
+    return topology;
+}
+
+std::vector<unsigned>
+placement_order(const std::vector<cpu_topology_entry> &topology,
+        const std::string &strategy)
+{
+    std::vector<cpu_topology_entry> cpus(topology);
+    if (strategy == "smt")
+    {
+        /* both hyperthreads of a core before the next core */
+        std::stable_sort(cpus.begin(), cpus.end(), [](const cpu_topology_entry &a, const cpu_topology_entry &b) {
+            return std::make_tuple(a.package, a.l3, a.core, a.smt_index) < std::make_tuple(b.package, b.l3, b.core, b.smt_index);
+        });
+    }
+    else if (strategy == "scatter" || strategy == "l3")
+    {
+        /* one thread per physical core, round-robin over the L3 domains */
+        std::map<int, std::map<std::pair<int, int>, unsigned>> cores;
+        std::map<unsigned, unsigned> core_rank;
+        for (auto &entry : cpus)
+            cores[entry.l3].insert(std::make_pair(std::make_pair(entry.package, entry.core), 0u));
+        for (auto &domain : cores)
+        {
+            unsigned rank = 0;
+            for (auto &core : domain.second)
+                core.second = rank++;
+        }
+        for (auto &entry : cpus)
+            core_rank[entry.cpuid] = cores[entry.l3][std::make_pair(entry.package, entry.core)];
+        std::stable_sort(cpus.begin(), cpus.end(), [&](const cpu_topology_entry &a, const cpu_topology_entry &b) {
+            return std::make_tuple(a.smt_index, core_rank[a.cpuid], a.l3) < std::make_tuple(b.smt_index, core_rank[b.cpuid], b.l3);
+        });
+        if (strategy == "l3")
+        {
+            /* only the first core of each L3 domain */
+            cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](const cpu_topology_entry &entry) {
+                return entry.smt_index != 0 || core_rank[entry.cpuid] != 0;
+            }), cpus.end());
+        }
+    }
+    /* "compact" keeps the OS numbering */
+    std::vector<unsigned> order;
+    for (auto &entry : cpus)
+        order.push_back(entry.cpuid);
+    return order;
+}
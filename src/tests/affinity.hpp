@@ -29,11 +29,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <thread>
 #include <string>
+#include <vector>
 
 int set_thread_affinity(const unsigned &cpuid);
 int set_thread_affinity(std::thread::native_handle_type thread,
         const unsigned &cpuid);
 unsigned cpuid_from_mask(uint64_t mask, const unsigned &thread_index);
 std::string mask_to_string(uint64_t mask);
+
+struct cpu_topology_entry {
+    unsigned cpuid;
+    int package;
+    int core;
+    int l3;             /* lowest cpuid sharing the L3 cache with this CPU */
+    unsigned smt_index; /* position among the SMT siblings of the core */
+};
+
+/* CPUs the process may run on, from sysfs; every CPU is its own core if unknown */
+std::vector<cpu_topology_entry> read_cpu_topology();
+/* order in which threads are pinned: "compact", "scatter", "smt" or "l3" */
+std::vector<unsigned> placement_order(const std::vector<cpu_topology_entry> &topology,
+        const std::string &strategy);
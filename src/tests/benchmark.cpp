@@ -30,14 +30,19 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
 #include <iomanip>
 #include <exception>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <utility>
+#include <algorithm>
 #include "stopwatch.hpp"
+#include "histogram.hpp"
 #include "utility.hpp"
 #include "../randomx.h"
 #include "../dataset.hpp"
+#include "../virtual_machine.hpp"
 #include "../blake2/endian.h"
 #include "../common.hpp"
 #ifdef _WIN32
@@ -71,11 +76,43 @@ public:
 private:
 	static void print(std::atomic<uint64_t>& hash, std::ostream& os) {
 		auto h = hash.load();
-		outputHex(std::cout, (char*)&h, sizeof(h));
+		outputHex(os, (char*)&h, sizeof(h));
 	}
 	std::atomic<uint64_t> hash[4];
 };
 
+void printPageInfo(const char* name, int valid, const randomx_page_info& info) {
+	if (!valid)
+		return;
+	std::cout << " - " << name << ": " << (info.page_size >> 10) << " KiB pages, "
+		<< (info.hugetlb_bytes >> 20) << " MiB hugetlb, " << (info.thp_bytes >> 20) << " MiB THP, "
+		<< (info.resident_bytes >> 20) << "/" << (info.size >> 20) << " MiB resident" << std::endl;
+}
+
+void printProfile(const randomx_profile& profile) {
+	const std::pair<const char*, uint64_t> phases[] = {
+		{ "fill scratchpad ", profile.fill_scratchpad },
+		{ "generate program", profile.generate_program },
+		{ "compile         ", profile.compile },
+		{ "execute         ", profile.execute },
+		{ "blake2b         ", profile.blake2b_hash },
+		{ "final hash      ", profile.final_hash },
+	};
+	uint64_t total = 0;
+	for (auto& phase : phases)
+		total += phase.second;
+	if (profile.hashes == 0 || total == 0)
+		return;
+	std::cout << "Phase breakdown (" << profile.hashes << " hashes):" << std::endl;
+	for (auto& phase : phases) {
+		std::cout << " - " << phase.first << ": " << std::setw(9) << std::fixed << std::setprecision(1)
+			<< phase.second / 1000.0 / profile.hashes << " us per hash (" << std::setw(4)
+			<< 100.0 * phase.second / total << "%)" << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
+
 void printUsage(const char* executable) {
 	std::cout << "Usage: " << executable << " [OPTIONS]" << std::endl;
 	std::cout << "Supported options:" << std::endl;
@@ -85,7 +122,13 @@ void printUsage(const char* executable) {
 	std::cout << "  --jit         JIT compiled mode (default: interpreter)" << std::endl;
 	std::cout << "  --secure      W^X policy for JIT pages (default: off)" << std::endl;
 	std::cout << "  --largePages  use large pages (default: small pages)" << std::endl;
+	std::cout << "  --arena       with --largePages --jit, share large-page regions between scratchpads" << std::endl;
+	std::cout << "  --firstTouch  with --largePages, dataset pages are faulted in by the init threads" << std::endl;
+	std::cout << "  --partial M   with --mine, precompute only M MiB of the dataset and compute the rest" << std::endl;
+	std::cout << "  --lazy        with --mine, start mining while Q threads initialize the dataset" << std::endl;
+	std::cout << "  --shared NAME with --mine, use the dataset shared by processes running with the same NAME" << std::endl;
 	std::cout << "  --softAes     use software AES (default: hardware AES)" << std::endl;
+	std::cout << "  --bitslice    use constant-time bitsliced software AES (slower than the default software AES)" << std::endl;
 	std::cout << "  --threads T   use T threads (default: 1)" << std::endl;
 	std::cout << "  --affinity A  thread affinity bitmask (default: 0)" << std::endl;
 	std::cout << "  --init Q      initialize dataset with Q threads (default: 1)" << std::endl;
@@ -94,6 +137,15 @@ void printUsage(const char* executable) {
 	std::cout << "  --ssse3       use optimized Argon2 for SSSE3 CPUs" << std::endl;
 	std::cout << "  --avx2        use optimized Argon2 for AVX2 CPUs" << std::endl;
 	std::cout << "  --auto        select the best options for the current CPU" << std::endl;
+	std::cout << "  --profile     print the time spent in each hashing phase (needs a PROFILE build)" << std::endl;
+	std::cout << "  --warmup W    report the first W nonces separately from the steady state (default: 0)" << std::endl;
+	std::cout << "  --json FILE   write the results as JSON to FILE ('-' for standard output)" << std::endl;
+	std::cout << "  --perf        count hardware events per hash (Linux perf events)" << std::endl;
+	std::cout << "  --sweep       measure 1..T threads (default: all CPUs) with compact, scatter, smt and l3" << std::endl;
+	std::cout << "                placement, running N nonces per thread for each configuration" << std::endl;
+	std::cout << "  --prefetch P  dataset (light JIT: next item) prefetch: nta, t0, t1, t2, none or auto (default: nta)" << std::endl;
+	std::cout << "  --autotune    measure the best flags and thread counts for this host (up to T threads) and save them" << std::endl;
+	std::cout << "  --tuning FILE with --autotune, tuning profile to update (default: $RANDOMX_TUNING or ~/.randomx-tuning)" << std::endl;
 }
 
 struct MemoryException : public std::exception {
@@ -109,55 +161,403 @@ struct DatasetAllocException : public MemoryException {
 	}
 };
 
-void mine(randomx_vm* vm, std::atomic<uint32_t>& atomicNonce, AtomicHash& result, uint32_t noncesCount, int thread, int cpuid=-1) {
+struct ThreadStats {
+	LatencyHistogram warmupLatency;
+	LatencyHistogram steadyLatency;
+	double warmupElapsed = 0; //seconds
+	double steadyElapsed = 0;
+	bool perfEnabled = false;
+	randomx_perf_counters perf;
+
+	uint64_t hashes() const {
+		return warmupLatency.count() + steadyLatency.count();
+	}
+};
+
+struct BenchmarkReport {
+	const char* mode;
+	randomx_flags flags;
+	int threads, initThreads, nonces, warmup;
+	int32_t seed;
+	double cacheInit, datasetInit, vmInit, elapsed; //seconds
+	bool lazy, attached;
+	std::string result;
+};
+
+static double hashrate(uint64_t hashes, double seconds) {
+	return seconds > 0 ? hashes / seconds : 0.0;
+}
+
+static const std::pair<uint64_t randomx_perf_counters::*, const char*> perfEvents[] = {
+	{ &randomx_perf_counters::cycles, "cycles" },
+	{ &randomx_perf_counters::instructions, "instructions" },
+	{ &randomx_perf_counters::l1d_misses, "l1d_misses" },
+	{ &randomx_perf_counters::l2_misses, "l2_misses" },
+	{ &randomx_perf_counters::llc_misses, "llc_misses" },
+	{ &randomx_perf_counters::dtlb_misses, "dtlb_misses" },
+	{ &randomx_perf_counters::branch_misses, "branch_misses" },
+};
+
+//sums the counters of all threads, a counter is unavailable if any thread could not open it
+static bool sumPerfCounters(const std::vector<ThreadStats>& stats, randomx_perf_counters& total) {
+	bool any = false;
+	total = {};
+	for (auto& thread : stats) {
+		if (!thread.perfEnabled)
+			continue;
+		any = true;
+		for (auto& event : perfEvents) {
+			if (thread.perf.*event.first == RANDOMX_PERF_UNAVAILABLE || total.*event.first == RANDOMX_PERF_UNAVAILABLE)
+				total.*event.first = RANDOMX_PERF_UNAVAILABLE;
+			else
+				total.*event.first += thread.perf.*event.first;
+		}
+		total.hashes += thread.perf.hashes;
+	}
+	return any;
+}
+
+static void writePerfCounters(std::ostream& os, const randomx_perf_counters& perf) {
+	os << "{\"hashes\": " << perf.hashes;
+	for (auto& event : perfEvents) {
+		os << ", \"" << event.second << "_per_hash\": ";
+		if (perf.*event.first == RANDOMX_PERF_UNAVAILABLE || perf.hashes == 0)
+			os << "null";
+		else
+			os << (double)(perf.*event.first) / perf.hashes;
+	}
+	os << "}";
+}
+
+void printPerfCounters(const std::vector<ThreadStats>& stats) {
+	randomx_perf_counters total;
+	if (!sumPerfCounters(stats, total) || total.hashes == 0) {
+		std::cout << "Performance counters are not available (no PMU or perf_event_paranoid too high)" << std::endl;
+		return;
+	}
+	std::cout << "Performance counters (" << total.hashes << " hashes):" << std::endl;
+	for (auto& event : perfEvents) {
+		std::cout << " - " << std::left << std::setw(14) << event.second << std::right << ": ";
+		if (total.*event.first == RANDOMX_PERF_UNAVAILABLE)
+			std::cout << "n/a" << std::endl;
+		else
+			std::cout << (double)(total.*event.first) / total.hashes << " per hash" << std::endl;
+	}
+	if (total.cycles != RANDOMX_PERF_UNAVAILABLE && total.instructions != RANDOMX_PERF_UNAVAILABLE && total.cycles > 0)
+		std::cout << " - IPC           : " << (double)total.instructions / total.cycles << std::endl;
+}
+
+static void writeLatency(std::ostream& os, const LatencyHistogram& h) {
+	os << "{\"min\": " << h.min() / 1e3 << ", \"mean\": " << h.mean() / 1e3
+		<< ", \"p50\": " << h.percentile(0.5) / 1e3 << ", \"p90\": " << h.percentile(0.9) / 1e3
+		<< ", \"p99\": " << h.percentile(0.99) / 1e3 << ", \"p999\": " << h.percentile(0.999) / 1e3
+		<< ", \"max\": " << h.max() / 1e3 << "}";
+}
+
+//warmup or steady-state part of the run, summed over all threads
+static void writePhase(std::ostream& os, const char* name, const std::vector<ThreadStats>& stats, bool steady) {
+	LatencyHistogram latency;
+	double rate = 0;
+	for (auto& thread : stats) {
+		auto& h = steady ? thread.steadyLatency : thread.warmupLatency;
+		latency.merge(h);
+		rate += hashrate(h.count(), steady ? thread.steadyElapsed : thread.warmupElapsed);
+	}
+	os << "  \"" << name << "\": {\"hashes\": " << latency.count() << ", \"hashrate\": " << rate << ", \"latency_us\": ";
+	writeLatency(os, latency);
+	os << "}," << std::endl;
+}
+
+void writeJsonReport(std::ostream& os, const BenchmarkReport& report, const std::vector<ThreadStats>& stats) {
+	static const std::pair<randomx_flags, const char*> flagNames[] = {
+		{ RANDOMX_FLAG_LARGE_PAGES, "large_pages" },
+		{ RANDOMX_FLAG_HARD_AES, "hard_aes" },
+		{ RANDOMX_FLAG_FULL_MEM, "full_mem" },
+		{ RANDOMX_FLAG_JIT, "jit" },
+		{ RANDOMX_FLAG_SECURE, "secure" },
+		{ RANDOMX_FLAG_ARGON2_SSSE3, "argon2_ssse3" },
+		{ RANDOMX_FLAG_ARGON2_AVX2, "argon2_avx2" },
+		{ RANDOMX_FLAG_BITSLICE_AES, "bitslice_aes" },
+		{ RANDOMX_FLAG_SCRATCHPAD_ARENA, "scratchpad_arena" },
+		{ RANDOMX_FLAG_FIRST_TOUCH, "first_touch" },
+	};
+	std::ios::fmtflags format = os.flags();
+	os << std::fixed << std::setprecision(3);
+	os << "{" << std::endl;
+	os << "  \"version\": \"1.1.7\"," << std::endl;
+	os << "  \"mode\": \"" << report.mode << "\"," << std::endl;
+	os << "  \"flags\": {\"value\": " << (int)report.flags;
+	for (auto& flag : flagNames)
+		os << ", \"" << flag.second << "\": " << ((report.flags & flag.first) ? "true" : "false");
+	os << "}," << std::endl;
+	os << "  \"threads\": " << report.threads << ", \"init_threads\": " << report.initThreads
+		<< ", \"nonces\": " << report.nonces << ", \"warmup_nonces\": " << report.warmup
+		<< ", \"seed\": " << report.seed << "," << std::endl;
+	os << "  \"init_s\": {\"cache\": " << report.cacheInit << ", \"dataset\": " << report.datasetInit
+		<< ", \"vms\": " << report.vmInit << ", \"dataset_lazy\": " << (report.lazy ? "true" : "false")
+		<< ", \"dataset_attached\": " << (report.attached ? "true" : "false") << "}," << std::endl;
+	os << "  \"elapsed_s\": " << report.elapsed << "," << std::endl;
+	uint64_t hashes = 0;
+	for (auto& thread : stats)
+		hashes += thread.hashes();
+	os << "  \"hashrate\": " << hashrate(hashes, report.elapsed) << "," << std::endl;
+	writePhase(os, "warmup", stats, false);
+	writePhase(os, "steady", stats, true);
+	randomx_perf_counters perf;
+	if (sumPerfCounters(stats, perf)) {
+		os << "  \"perf\": ";
+		writePerfCounters(os, perf);
+		os << "," << std::endl;
+	}
+	os << "  \"per_thread\": [";
+	for (unsigned i = 0; i < stats.size(); ++i) {
+		auto& thread = stats[i];
+		os << (i ? "," : "") << std::endl << "    {\"thread\": " << i << ", \"hashes\": " << thread.hashes()
+			<< ", \"hashrate\": " << hashrate(thread.hashes(), thread.warmupElapsed + thread.steadyElapsed)
+			<< ", \"steady_hashrate\": " << hashrate(thread.steadyLatency.count(), thread.steadyElapsed)
+			<< ", \"steady_latency_us\": ";
+		writeLatency(os, thread.steadyLatency);
+		if (thread.perfEnabled) {
+			os << ", \"perf\": ";
+			writePerfCounters(os, thread.perf);
+		}
+		os << "}";
+	}
+	os << std::endl << "  ]," << std::endl;
+	os << "  \"result\": \"" << report.result << "\"" << std::endl;
+	os << "}" << std::endl;
+	os.flags(format);
+}
+
+void mine(randomx_vm* vm, std::atomic<uint32_t>& atomicNonce, AtomicHash& result, uint32_t noncesCount, uint32_t warmupCount, bool perf, ThreadStats& stats, int thread, int cpuid=-1) {
 	if (cpuid >= 0) {
 		int rc = set_thread_affinity(cpuid);
 		if (rc) {
 			std::cerr << "Failed to set thread affinity for thread " << thread << " (error=" << rc << ")" <<  std::endl;
 		}
 	}
+	//perf events count the thread that opens them
+	stats.perfEnabled = perf && randomx_vm_enable_perf_counters(vm) > 0;
 	uint64_t hash[RANDOMX_HASH_SIZE / sizeof(uint64_t)];
 	uint8_t blockTemplate[sizeof(blockTemplate_)];
 	memcpy(blockTemplate, blockTemplate_, sizeof(blockTemplate));
 	void* noncePtr = blockTemplate + 39;
 	auto nonce = atomicNonce.fetch_add(1);
 
+	auto threadStart = std::chrono::steady_clock::now();
+	auto start = threadStart, steadyStart = threadStart;
 	store32(noncePtr, nonce);
 	randomx_calculate_hash_first(vm, blockTemplate, sizeof(blockTemplate));
 
 	while (nonce < noncesCount) {
+		//each call finishes the hash of the previous nonce
+		bool warmup = nonce < warmupCount;
 		nonce = atomicNonce.fetch_add(1);
 		store32(noncePtr, nonce);
 		randomx_calculate_hash_next(vm, blockTemplate, sizeof(blockTemplate), &hash);
+		auto end = std::chrono::steady_clock::now();
+		uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		if (warmup) {
+			stats.warmupLatency.record(ns);
+			steadyStart = end;
+		}
+		else {
+			stats.steadyLatency.record(ns);
+		}
+		start = end;
 		result.xorWith(hash);
 	}
+	stats.warmupElapsed = std::chrono::duration<double>(steadyStart - threadStart).count();
+	stats.steadyElapsed = std::chrono::duration<double>(start - steadyStart).count();
+	if (stats.perfEnabled)
+		randomx_vm_get_perf_counters(vm, &stats.perf);
+}
+
+//steady-state hashrate of one thread per CPU in the given order
+double runPlacement(std::vector<randomx_vm*>& vms, const std::vector<unsigned>& cpus, uint32_t noncesCount, uint32_t warmupCount) {
+	std::atomic<uint32_t> atomicNonce(0);
+	AtomicHash result;
+	std::vector<ThreadStats> stats(cpus.size());
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < cpus.size(); ++i) {
+		threads.push_back(std::thread(&mine, vms[i], std::ref(atomicNonce), std::ref(result), noncesCount, warmupCount, false, std::ref(stats[i]), i, cpus[i]));
+	}
+	double rate = 0;
+	for (unsigned i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+		rate += hashrate(stats[i].steadyLatency.count(), stats[i].steadyElapsed);
+	}
+	return rate;
+}
+
+void runSweep(std::vector<randomx_vm*>& vms, const std::vector<cpu_topology_entry>& topology, int noncesPerThread, int warmupCount) {
+	static const char* strategies[] = { "compact", "scatter", "smt", "l3" };
+	std::cout << "Sweeping 1-" << vms.size() << " threads (" << noncesPerThread << " nonces per thread) ..." << std::endl;
+	double baseline = 0, best = 0;
+	const char* bestStrategy = nullptr;
+	std::vector<unsigned> bestCpus;
+	for (unsigned threadCount = 1; threadCount <= vms.size(); ++threadCount) {
+		std::vector<std::vector<unsigned>> tried;
+		for (const char* strategy : strategies) {
+			auto cpus = placement_order(topology, strategy);
+			if (cpus.size() < threadCount)
+				continue;
+			cpus.resize(threadCount);
+			//strategies often agree, e.g. without SMT or with a single L3
+			auto cpuSet = cpus;
+			std::sort(cpuSet.begin(), cpuSet.end());
+			if (std::find(tried.begin(), tried.end(), cpuSet) != tried.end())
+				continue;
+			tried.push_back(cpuSet);
+			//the first hash of every thread includes the cold scratchpad and is not counted
+			double rate = runPlacement(vms, cpus, noncesPerThread * threadCount, warmupCount + threadCount);
+			if (threadCount == 1 && baseline == 0)
+				baseline = rate;
+			std::cout << std::setw(3) << threadCount << " threads " << std::left << std::setw(8) << strategy << std::right
+				<< std::fixed << std::setprecision(1) << std::setw(10) << rate << " H/s " << std::setprecision(2)
+				<< std::setw(6) << (baseline > 0 ? rate / baseline : 0.0) << "x  CPUs";
+			for (unsigned cpu : cpus)
+				std::cout << " " << cpu;
+			std::cout << std::endl;
+			std::cout.unsetf(std::ios::floatfield);
+			std::cout << std::setprecision(6);
+			if (rate > best) {
+				best = rate;
+				bestStrategy = strategy;
+				bestCpus = cpus;
+			}
+		}
+	}
+	if (bestStrategy == nullptr)
+		return;
+	std::cout << "Best: " << bestCpus.size() << " threads, " << bestStrategy << " placement, " << best << " H/s";
+	uint64_t mask = 0;
+	bool fitsMask = true;
+	for (unsigned cpu : bestCpus) {
+		if (cpu >= 64)
+			fitsMask = false;
+		else
+			mask |= 1ULL << cpu;
+	}
+	//--affinity assigns CPUs to threads in ascending order, the placement itself does not matter
+	if (fitsMask)
+		std::cout << " (--threads " << bestCpus.size() << " --affinity 0x" << std::hex << mask << std::dec << ")";
+	std::cout << std::endl;
+}
+
+static const char* prefetchModeNames[RANDOMX_PREFETCH_MODES] = { "nta", "t0", "t1", "t2", "none" };
+
+//returns RANDOMX_PREFETCH_MODES for "auto" and -1 for an unknown name
+static int parsePrefetchMode(const char* name) {
+	if (strcmp(name, "auto") == 0)
+		return RANDOMX_PREFETCH_MODES;
+	for (int mode = 0; mode < RANDOMX_PREFETCH_MODES; ++mode) {
+		if (strcmp(name, prefetchModeNames[mode]) == 0)
+			return mode;
+	}
+	return -1;
+}
+
+static void setPrefetchMode(std::vector<randomx_vm*>& vms, randomx_prefetch_mode mode) {
+	for (auto vm : vms)
+		randomx_vm_set_prefetch_mode(vm, mode);
+}
+
+randomx_prefetch_mode selectPrefetchMode(std::vector<randomx_vm*>& vms, uint64_t threadAffinity, uint32_t noncesCount) {
+	std::cout << "Measuring dataset prefetch modes (" << noncesCount << " nonces each) ..." << std::endl;
+	randomx_prefetch_mode best = RANDOMX_PREFETCH_NTA;
+	double bestRate = 0;
+	for (int mode = 0; mode < RANDOMX_PREFETCH_MODES; ++mode) {
+		setPrefetchMode(vms, (randomx_prefetch_mode)mode);
+		std::atomic<uint32_t> atomicNonce(0);
+		AtomicHash result;
+		std::vector<ThreadStats> stats(vms.size());
+		std::vector<std::thread> threads;
+		for (unsigned i = 0; i < vms.size(); ++i) {
+			int cpuid = threadAffinity ? cpuid_from_mask(threadAffinity, i) : -1;
+			//the first hash of every thread includes the cold scratchpad and is not counted
+			threads.push_back(std::thread(&mine, vms[i], std::ref(atomicNonce), std::ref(result), noncesCount, (uint32_t)vms.size(), false, std::ref(stats[i]), i, cpuid));
+		}
+		double rate = 0;
+		for (unsigned i = 0; i < threads.size(); ++i) {
+			threads[i].join();
+			rate += hashrate(stats[i].steadyLatency.count(), stats[i].steadyElapsed);
+		}
+		std::streamsize precision = std::cout.precision();
+		std::cout << "  " << std::left << std::setw(6) << prefetchModeNames[mode] << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << rate << " H/s" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+		std::cout.precision(precision);
+		if (rate > bestRate) {
+			bestRate = rate;
+			best = (randomx_prefetch_mode)mode;
+		}
+	}
+	std::cout << "Fastest dataset prefetch: " << prefetchModeNames[best] << " (--prefetch " << prefetchModeNames[best] << ")" << std::endl;
+	return best;
+}
+
+void runAutotune(randomx_dataset* dataset, unsigned maxThreads, const char* path) {
+	std::cout << "Autotuning (" << (dataset != nullptr ? "full" : "light") << " mode) ..." << std::endl;
+	randomx_tuning tuning;
+	if (!randomx_autotune(&tuning, dataset, maxThreads, 2000)) {
+		std::cout << "Autotune failed: out of memory" << std::endl;
+		return;
+	}
+	std::cout << "Large pages: " << ((tuning.flags & RANDOMX_FLAG_LARGE_PAGES) ? "yes" : "no") << std::endl;
+	std::cout << "Secure JIT: " << ((tuning.flags & RANDOMX_FLAG_SECURE) ? "yes" : "no") << std::endl;
+	std::cout << "Hashing threads: " << tuning.threads << std::endl;
+	std::cout << "Dataset init threads: " << tuning.init_threads << std::endl;
+	std::cout << "Performance: " << tuning.hashrate << " hashes per second" << std::endl;
+	if (randomx_save_tuning(path, &tuning))
+		std::cout << "Tuning profile saved" << std::endl;
+	else
+		std::cout << "Cannot write the tuning profile" << std::endl;
 }
 
 int main(int argc, char** argv) {
-	bool softAes, miningMode, verificationMode, help, largePages, jit, secure, ssse3, avx2, autoFlags;
-	int noncesCount, threadCount, initThreadCount;
+	bool softAes, bitslice, miningMode, verificationMode, help, largePages, arena, firstTouch, lazy, jit, secure, ssse3, avx2, autoFlags, profile, perf, sweep, tune;
+	int noncesCount, threadCount, initThreadCount, partialSize, warmupCount;
 	uint64_t threadAffinity;
 	int32_t seedValue;
 	char seed[4];
+	const char* sharedName;
+	const char* jsonPath;
+	const char* tuningPath;
+	const char* prefetchName;
 
 	readOption("--softAes", argc, argv, softAes);
+	readOption("--bitslice", argc, argv, bitslice);
 	readOption("--mine", argc, argv, miningMode);
 	readOption("--verify", argc, argv, verificationMode);
 	readIntOption("--threads", argc, argv, threadCount, 1);
 	readUInt64Option("--affinity", argc, argv, threadAffinity, 0);
 	readIntOption("--nonces", argc, argv, noncesCount, 1000);
 	readIntOption("--init", argc, argv, initThreadCount, 1);
+	readIntOption("--partial", argc, argv, partialSize, 0);
+	readIntOption("--warmup", argc, argv, warmupCount, 0);
 	readIntOption("--seed", argc, argv, seedValue, 0);
 	readOption("--largePages", argc, argv, largePages);
 	if (!largePages) {
 		readOption("--largepages", argc, argv, largePages);
 	}
+	readOption("--arena", argc, argv, arena);
+	readOption("--firstTouch", argc, argv, firstTouch);
+	readOption("--lazy", argc, argv, lazy);
+	readStringOption("--shared", argc, argv, sharedName, nullptr);
 	readOption("--jit", argc, argv, jit);
 	readOption("--help", argc, argv, help);
 	readOption("--secure", argc, argv, secure);
 	readOption("--ssse3", argc, argv, ssse3);
 	readOption("--avx2", argc, argv, avx2);
 	readOption("--auto", argc, argv, autoFlags);
+	readOption("--profile", argc, argv, profile);
+	readOption("--perf", argc, argv, perf);
+	readOption("--sweep", argc, argv, sweep);
+	readStringOption("--json", argc, argv, jsonPath, nullptr);
+	readOption("--autotune", argc, argv, tune);
+	readStringOption("--tuning", argc, argv, tuningPath, nullptr);
+	readStringOption("--prefetch", argc, argv, prefetchName, "nta");
 
 	store32(&seed, seedValue);
 
@@ -168,12 +568,25 @@ int main(int argc, char** argv) {
 		return 0;
 	}
 
+	int prefetchMode = parsePrefetchMode(prefetchName);
+	if (prefetchMode < 0) {
+		std::cout << "Unknown prefetch mode '" << prefetchName << "'" << std::endl;
+		return 1;
+	}
+
 	if (!miningMode && !verificationMode) {
 		std::cout << "Please select either the fast mode (--mine) or the slow mode (--verify)" << std::endl;
 		std::cout << "Run '" << argv[0] << " --help' to see all supported options" << std::endl;
 		return 0;
 	}
 
+	std::vector<cpu_topology_entry> topology;
+	if (sweep) {
+		topology = read_cpu_topology();
+		if (threadCount == 1 || threadCount > (int)topology.size())
+			threadCount = (int)topology.size();
+	}
+
 	std::atomic<uint32_t> atomicNonce(0);
 	AtomicHash result;
 	std::vector<randomx_vm*> vms;
@@ -194,7 +607,10 @@ int main(int argc, char** argv) {
 		if (avx2) {
 			flags |= RANDOMX_FLAG_ARGON2_AVX2;
 		}
-		if (!softAes) {
+		if (bitslice) {
+			flags |= RANDOMX_FLAG_BITSLICE_AES;
+		}
+		else if (!softAes) {
 			flags |= RANDOMX_FLAG_HARD_AES;
 		}
 		if (jit) {
@@ -207,6 +623,12 @@ int main(int argc, char** argv) {
 
 	if (largePages) {
 		flags |= RANDOMX_FLAG_LARGE_PAGES;
+		if (arena) {
+			flags |= RANDOMX_FLAG_SCRATCHPAD_ARENA;
+		}
+		if (firstTouch) {
+			flags |= RANDOMX_FLAG_FIRST_TOUCH;
+		}
 	}
 	if (miningMode) {
 		flags |= RANDOMX_FLAG_FULL_MEM;
@@ -248,12 +670,18 @@ int main(int argc, char** argv) {
 	if (flags & RANDOMX_FLAG_HARD_AES) {
 		std::cout << " - hardware AES mode" << std::endl;
 	}
+	else if (flags & RANDOMX_FLAG_BITSLICE_AES) {
+		std::cout << " - software AES mode (bitsliced)" << std::endl;
+	}
 	else {
 		std::cout << " - software AES mode" << std::endl;
 	}
 
 	if (flags & RANDOMX_FLAG_LARGE_PAGES) {
-		std::cout << " - large pages mode" << std::endl;
+		std::cout << " - large pages mode";
+		if (flags & RANDOMX_FLAG_SCRATCHPAD_ARENA)
+			std::cout << " (scratchpad arena)";
+		std::cout << std::endl;
 	}
 	else {
 		std::cout << " - small pages mode" << std::endl;
@@ -279,40 +707,85 @@ int main(int argc, char** argv) {
 			std::cout << "WARNING: You are using the interpreter mode. Use --jit for optimal performance." << std::endl;
 		}
 
-		Stopwatch sw(true);
+		Stopwatch sw(true), cacheTimer(true), datasetTimer, vmTimer;
+		bool attached = false;
 		cache = randomx_alloc_cache(flags);
 		if (cache == nullptr) {
 			throw CacheAllocException();
 		}
-		randomx_init_cache(cache, &seed, sizeof(seed));
-		if (miningMode) {
-			dataset = randomx_alloc_dataset(flags);
+		if (!miningMode) {
+			randomx_init_cache(cache, &seed, sizeof(seed));
+			cacheTimer.stop();
+		}
+		else {
+			cacheTimer.stop();
+			datasetTimer.start();
+			uint32_t datasetItemCount = randomx_dataset_item_count();
+			if (partialSize > 0 && (uint64_t)partialSize * 1024 * 1024 / RANDOMX_DATASET_ITEM_SIZE < datasetItemCount) {
+				datasetItemCount = (uint64_t)partialSize * 1024 * 1024 / RANDOMX_DATASET_ITEM_SIZE;
+				dataset = randomx_alloc_dataset_partial(flags, datasetItemCount);
+			}
+			else if (sharedName != nullptr) {
+				dataset = randomx_alloc_dataset_shared(sharedName, flags);
+			}
+			else {
+				dataset = randomx_alloc_dataset(flags);
+			}
 			if (dataset == nullptr) {
 				throw DatasetAllocException();
 			}
-			uint32_t datasetItemCount = randomx_dataset_item_count();
-			if (initThreadCount > 1) {
-				auto perThread = datasetItemCount / initThreadCount;
-				auto remainder = datasetItemCount % initThreadCount;
-				uint32_t startItem = 0;
-				for (int i = 0; i < initThreadCount; ++i) {
-					auto count = perThread + (i == initThreadCount - 1 ? remainder : 0);
-					threads.push_back(std::thread(&randomx_init_dataset, dataset, cache, startItem, count));
-					startItem += count;
-				}
-				for (unsigned i = 0; i < threads.size(); ++i) {
-					threads[i].join();
+			int claim = randomx_begin_dataset_init(dataset, &seed, sizeof(seed));
+			if (claim < 0) {
+				std::cout << "The shared dataset is used with another seed, using a private dataset" << std::endl;
+				randomx_release_dataset(dataset);
+				dataset = randomx_alloc_dataset(flags);
+				if (dataset == nullptr) {
+					throw DatasetAllocException();
 				}
+				claim = randomx_begin_dataset_init(dataset, &seed, sizeof(seed));
+			}
+			if (claim == 0) {
+				std::cout << "Attached to the shared dataset" << std::endl;
+				attached = true;
 			}
 			else {
-				randomx_init_dataset(dataset, cache, 0, datasetItemCount);
+				datasetTimer.stop();
+				cacheTimer.start();
+				randomx_init_cache(cache, &seed, sizeof(seed));
+				cacheTimer.stop();
+				datasetTimer.start();
+				if (lazy && randomx_init_dataset_lazy(dataset, cache, initThreadCount)) {
+					std::cout << "Initializing dataset in the background" << std::endl;
+				}
+				else if (initThreadCount > 1) {
+					auto perThread = datasetItemCount / initThreadCount;
+					auto remainder = datasetItemCount % initThreadCount;
+					uint32_t startItem = 0;
+					for (int i = 0; i < initThreadCount; ++i) {
+						auto count = perThread + (i == initThreadCount - 1 ? remainder : 0);
+						threads.push_back(std::thread(&randomx_init_dataset, dataset, cache, startItem, count));
+						startItem += count;
+					}
+					for (unsigned i = 0; i < threads.size(); ++i) {
+						threads[i].join();
+					}
+				}
+				else {
+					randomx_init_dataset(dataset, cache, 0, datasetItemCount);
+				}
+				randomx_end_dataset_init(dataset);
+			}
+			datasetTimer.stop();
+			//a partial dataset needs the cache for the missing items
+			if (randomx_dataset_ready(dataset) && datasetItemCount == randomx_dataset_item_count()) {
+				randomx_release_cache(cache);
+				cache = nullptr;
 			}
-			randomx_release_cache(cache);
-			cache = nullptr;
 			threads.clear();
 		}
 		std::cout << "Memory initialized in " << sw.getElapsed() << " s" << std::endl;
 		std::cout << "Initializing " << threadCount << " virtual machine(s) ..." << std::endl;
+		vmTimer.start();
 		for (int i = 0; i < threadCount; ++i) {
 			randomx_vm *vm = randomx_create_vm(flags, cache, dataset);
 			if (vm == nullptr) {
@@ -326,6 +799,39 @@ int main(int argc, char** argv) {
 			}
 			vms.push_back(vm);
 		}
+		vmTimer.stop();
+		std::vector<ThreadStats> stats(vms.size());
+		randomx_page_info pageInfo;
+		if (miningMode)
+			printPageInfo("dataset", randomx_dataset_page_info(dataset, &pageInfo), pageInfo);
+		else
+			printPageInfo("cache", randomx_cache_page_info(cache, &pageInfo), pageInfo);
+		printPageInfo("scratchpad", randomx_scratchpad_page_info(vms[0], &pageInfo), pageInfo);
+		if (sweep) {
+			runSweep(vms, topology, noncesCount, warmupCount);
+		}
+		else if (tune) {
+			runAutotune(miningMode ? dataset : nullptr, threadCount > 1 ? threadCount : 0, tuningPath);
+		}
+		if (sweep || tune) {
+			for (unsigned i = 0; i < vms.size(); ++i)
+				randomx_destroy_vm(vms[i]);
+			if (miningMode) {
+				randomx_wait_dataset(dataset);
+				randomx_release_dataset(dataset);
+			}
+			if (cache != nullptr)
+				randomx_release_cache(cache);
+			return 0;
+		}
+		if (prefetchMode == RANDOMX_PREFETCH_MODES) {
+			if (miningMode || jit)
+				prefetchMode = selectPrefetchMode(vms, threadAffinity, std::max(noncesCount / RANDOMX_PREFETCH_MODES, threadCount + 1));
+			else
+				std::cout << "Dataset prefetch has no effect in interpreted light mode" << std::endl;
+		}
+		if (prefetchMode < RANDOMX_PREFETCH_MODES)
+			setPrefetchMode(vms, (randomx_prefetch_mode)prefetchMode);
 		std::cout << "Running benchmark (" << noncesCount << " nonces) ..." << std::endl;
 		sw.restart();
 		if (threadCount > 1) {
@@ -333,22 +839,42 @@ int main(int argc, char** argv) {
 				int cpuid = -1;
 				if (threadAffinity)
 					cpuid = cpuid_from_mask(threadAffinity, i);
-				threads.push_back(std::thread(&mine, vms[i], std::ref(atomicNonce), std::ref(result), noncesCount, i, cpuid));
+				threads.push_back(std::thread(&mine, vms[i], std::ref(atomicNonce), std::ref(result), noncesCount, warmupCount, perf, std::ref(stats[i]), i, cpuid));
 			}
 			for (unsigned i = 0; i < threads.size(); ++i) {
 				threads[i].join();
 			}
 		}
 		else {
-			mine(vms[0], std::ref(atomicNonce), std::ref(result), noncesCount, 0);
+			mine(vms[0], std::ref(atomicNonce), std::ref(result), noncesCount, warmupCount, perf, stats[0], 0);
 		}
 
 		double elapsed = sw.getElapsed();
-		for (unsigned i = 0; i < vms.size(); ++i)
+		uint64_t dispatchesSaved = 0;
+		randomx_profile totalProfile = {};
+		bool profiled = false;
+		for (unsigned i = 0; i < vms.size(); ++i) {
+			dispatchesSaved += vms[i]->getDispatchesSaved();
+			randomx_profile vmProfile;
+			if (profile && randomx_get_profile(vms[i], &vmProfile)) {
+				profiled = true;
+				totalProfile.fill_scratchpad += vmProfile.fill_scratchpad;
+				totalProfile.generate_program += vmProfile.generate_program;
+				totalProfile.compile += vmProfile.compile;
+				totalProfile.execute += vmProfile.execute;
+				totalProfile.blake2b_hash += vmProfile.blake2b_hash;
+				totalProfile.final_hash += vmProfile.final_hash;
+				totalProfile.hashes += vmProfile.hashes;
+			}
 			randomx_destroy_vm(vms[i]);
-		if (miningMode)
+		}
+		if (miningMode) {
+			std::cout << "Dataset " << (randomx_dataset_ready(dataset) ? "was" : "was not") << " complete at the end of the benchmark" << std::endl;
+			if (!randomx_wait_dataset(dataset))
+				std::cout << "WARNING: lazy dataset initialization failed, the result may be invalid" << std::endl;
 			randomx_release_dataset(dataset);
-		else
+		}
+		if (cache != nullptr)
 			randomx_release_cache(cache);
 		std::cout << "Calculated result: ";
 		result.print(std::cout);
@@ -360,6 +886,47 @@ int main(int argc, char** argv) {
 		else {
 			std::cout << "Performance: " << noncesCount / elapsed << " hashes per second" << std::endl;
 		}
+		if (!(flags & RANDOMX_FLAG_JIT)) {
+			std::cout << "Fused dispatches: " << dispatchesSaved / noncesCount << " saved per hash" << std::endl;
+		}
+		if (profiled) {
+			printProfile(totalProfile);
+		}
+		else if (profile) {
+			std::cout << "Phase breakdown is not available: rebuild with -DPROFILE=ON" << std::endl;
+		}
+		if (perf) {
+			printPerfCounters(stats);
+		}
+		if (jsonPath != nullptr) {
+			std::ostringstream hex;
+			result.print(hex);
+			BenchmarkReport report;
+			report.mode = miningMode ? "mine" : "verify";
+			report.flags = flags;
+			report.threads = threadCount;
+			report.initThreads = initThreadCount;
+			report.nonces = noncesCount;
+			report.warmup = warmupCount;
+			report.seed = seedValue;
+			report.cacheInit = cacheTimer.getElapsed();
+			report.datasetInit = datasetTimer.getElapsed();
+			report.vmInit = vmTimer.getElapsed();
+			report.elapsed = elapsed;
+			report.lazy = lazy && miningMode && !attached;
+			report.attached = attached;
+			report.result = hex.str().substr(0, 2 * RANDOMX_HASH_SIZE);
+			if (strcmp(jsonPath, "-") == 0) {
+				writeJsonReport(std::cout, report, stats);
+			}
+			else {
+				std::ofstream json(jsonPath);
+				writeJsonReport(json, report, stats);
+				if (!json) {
+					throw std::runtime_error("Cannot write the JSON report");
+				}
+			}
+		}
 	}
 	catch (MemoryException& e) {
 		std::cout << "ERROR: " << e.what() << std::endl;
@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+//log-linear histogram of durations in nanoseconds, relative error below 1/SubBuckets
+class LatencyHistogram {
+public:
+	LatencyHistogram() : buckets(), total(0), sum(0), minValue(UINT64_MAX), maxValue(0) {}
+	void record(uint64_t ns) {
+		buckets[bucketIndex(ns)]++;
+		total++;
+		sum += ns;
+		if (ns < minValue)
+			minValue = ns;
+		if (ns > maxValue)
+			maxValue = ns;
+	}
+	void merge(const LatencyHistogram& other) {
+		for (unsigned i = 0; i < BucketCount; ++i)
+			buckets[i] += other.buckets[i];
+		total += other.total;
+		sum += other.sum;
+		if (other.minValue < minValue)
+			minValue = other.minValue;
+		if (other.maxValue > maxValue)
+			maxValue = other.maxValue;
+	}
+	uint64_t count() const {
+		return total;
+	}
+	uint64_t min() const {
+		return total ? minValue : 0;
+	}
+	uint64_t max() const {
+		return maxValue;
+	}
+	double mean() const {
+		return total ? (double)sum / total : 0.0;
+	}
+	//value at quantile q (0 < q <= 1), reported as the midpoint of its bucket
+	uint64_t percentile(double q) const {
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t)std::ceil(q * total);
+		if (rank == 0)
+			rank = 1;
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < BucketCount; ++i) {
+			seen += buckets[i];
+			if (seen >= rank) {
+				uint64_t low = bucketLow(i), high = bucketLow(i + 1) - 1;
+				uint64_t mid = low + (high - low) / 2;
+				return mid < minValue ? minValue : mid > maxValue ? maxValue : mid;
+			}
+		}
+		return maxValue;
+	}
+private:
+	static constexpr unsigned SubBucketBits = 5;
+	static constexpr unsigned SubBuckets = 1 << SubBucketBits;
+	static constexpr unsigned BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+	//values below SubBuckets map 1:1, each following power of two is split into SubBuckets
+	static unsigned bucketIndex(uint64_t value) {
+		if (value < SubBuckets)
+			return (unsigned)value;
+		unsigned msb = 63;
+		while (!(value >> msb))
+			--msb;
+		unsigned shift = msb - SubBucketBits;
+		return (shift + 1) * SubBuckets + (unsigned)((value >> shift) - SubBuckets);
+	}
+	static uint64_t bucketLow(unsigned index) {
+		if (index < SubBuckets)
+			return index;
+		unsigned shift = index / SubBuckets - 1;
+		if (shift + SubBucketBits >= 64)
+			return UINT64_MAX;
+		return (uint64_t)(SubBuckets + index % SubBuckets) << shift;
+	}
+
+	uint64_t buckets[BucketCount];
+	uint64_t total;
+	uint64_t sum;
+	uint64_t minValue;
+	uint64_t maxValue;
+};
@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2018-2019, tevador <tevador@gmail.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+	* Redistributions of source code must retain the above copyright
+	  notice, this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright
+	  notice, this list of conditions and the following disclaimer in the
+	  documentation and/or other materials provided with the distribution.
+	* Neither the name of the copyright holder nor the
+	  names of its contributors may be used to endorse or promote products
+	  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include "utility.hpp"
+#include "../randomx.h"
+#include "../common.hpp"
+#include "../dataset.hpp"
+#include "../aes_hash.hpp"
+#include "../program.hpp"
+#include "../superscalar.hpp"
+#include "../blake2_generator.hpp"
+#include "../jit_compiler.hpp"
+#include "../allocator.hpp"
+#include "../cpu.hpp"
+#include "../argon2.h"
+#include "../argon2_core.h"
+#include "../blake2/blake2.h"
+
+struct Result {
+	double median; //nanoseconds per call
+	double mad;
+	uint64_t batch;
+};
+
+static double medianOf(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	size_t mid = values.size() / 2;
+	return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+//times batches of calls; the batch size is chosen so that a sample takes at least 1 ms
+static Result measure(const std::function<void()>& kernel, int warmup, int repetitions) {
+	using clock = std::chrono::steady_clock;
+	auto timeBatch = [&](uint64_t batch) {
+		auto start = clock::now();
+		for (uint64_t i = 0; i < batch; ++i)
+			kernel();
+		return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	};
+	uint64_t batch = 1;
+	double elapsed;
+	while ((elapsed = timeBatch(batch)) < 1e6 && batch < (1ULL << 30))
+		batch *= elapsed > 0 ? std::max<uint64_t>(2, std::min<uint64_t>(1000, (uint64_t)(1e6 / elapsed) + 1)) : 1000;
+	for (int i = 0; i < warmup; ++i)
+		timeBatch(batch);
+	std::vector<double> samples;
+	for (int i = 0; i < repetitions; ++i)
+		samples.push_back(timeBatch(batch) / batch);
+	Result result;
+	result.median = medianOf(samples);
+	for (auto& sample : samples)
+		sample = std::abs(sample - result.median);
+	result.mad = medianOf(samples);
+	result.batch = batch;
+	return result;
+}
+
+static std::string formatTime(double ns) {
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(2);
+	if (ns < 1e3)
+		os << ns << " ns";
+	else if (ns < 1e6)
+		os << ns / 1e3 << " us";
+	else
+		os << ns / 1e6 << " ms";
+	return os.str();
+}
+
+//Argon2 instance over a cache-sized buffer, set up like randomx::initCache
+class ArgonFill {
+public:
+	ArgonFill(randomx_argon2_impl* impl) {
+		memory = (uint8_t*)randomx::DefaultAllocator::allocMemory(randomx::CacheSize);
+		argon2_context context = {};
+		const char key[] = "RandomX microbench";
+		context.pwd = (uint8_t*)key;
+		context.pwdlen = (uint32_t)(sizeof(key) - 1);
+		context.salt = (uint8_t*)RANDOMX_ARGON_SALT;
+		context.saltlen = (uint32_t)randomx::ArgonSaltSize;
+		context.t_cost = RANDOMX_ARGON_ITERATIONS;
+		context.m_cost = RANDOMX_ARGON_MEMORY;
+		context.lanes = RANDOMX_ARGON_LANES;
+		context.threads = 1;
+		context.flags = ARGON2_DEFAULT_FLAGS;
+		context.version = ARGON2_VERSION_NUMBER;
+		uint32_t segmentLength = context.m_cost / (context.lanes * ARGON2_SYNC_POINTS);
+		instance.version = context.version;
+		instance.passes = context.t_cost;
+		instance.memory_blocks = context.m_cost;
+		instance.segment_length = segmentLength;
+		instance.lane_length = segmentLength * ARGON2_SYNC_POINTS;
+		instance.lanes = context.lanes;
+		instance.threads = 1;
+		instance.type = Argon2_d;
+		instance.memory = (block*)memory;
+		instance.impl = impl;
+		randomx_argon2_initialize(&instance, &context);
+	}
+	~ArgonFill() {
+		randomx::DefaultAllocator::freeMemory(memory, randomx::CacheSize);
+	}
+	void operator()() {
+		randomx_argon2_fill_memory_blocks(&instance);
+	}
+private:
+	uint8_t* memory;
+	argon2_instance_t instance;
+};
+
+void printUsage(const char* executable) {
+	std::cout << "Usage: " << executable << " [OPTIONS]" << std::endl;
+	std::cout << "Supported options:" << std::endl;
+	std::cout << "  --help        shows this message" << std::endl;
+	std::cout << "  --filter F    run only kernels whose name contains F" << std::endl;
+	std::cout << "  --warmup W    W untimed batches before measuring (default: 2)" << std::endl;
+	std::cout << "  --reps R      R timed batches per kernel (default: 15)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	bool help;
+	int warmup, repetitions;
+	const char* filter;
+	readOption("--help", argc, argv, help);
+	readIntOption("--warmup", argc, argv, warmup, 2);
+	readIntOption("--reps", argc, argv, repetitions, 15);
+	readStringOption("--filter", argc, argv, filter, "");
+
+	std::cout << "RandomX microbenchmark" << std::endl;
+	if (help) {
+		printUsage(argv[0]);
+		return 0;
+	}
+
+	randomx::Cpu cpu;
+	randomx_cache* cache = randomx_alloc_cache(RANDOMX_FLAG_DEFAULT);
+	if (cache == nullptr) {
+		std::cout << "ERROR: Cache allocation failed" << std::endl;
+		return 1;
+	}
+	randomx_init_cache(cache, "RandomX microbench", 18);
+
+	uint8_t* scratchpad = (uint8_t*)randomx::DefaultAllocator::allocMemory(randomx::ScratchpadSize);
+	alignas(16) uint64_t state[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	alignas(16) uint64_t hash[8];
+	alignas(64) randomx::Program program;
+	randomx::ProgramConfiguration config = {};
+	uint8_t input[256] = {};
+	uint64_t registers[8] = {};
+	uint64_t itemNumber = 0;
+	uint32_t nonce = 0;
+	randomx::SuperscalarProgram superscalar;
+	fillAes4Rx4<true>(state, sizeof(program), &program);
+	memset(scratchpad, 0, randomx::ScratchpadSize);
+
+	std::vector<std::pair<std::string, std::function<void()>>> kernels;
+	auto add = [&](const std::string& name, std::function<void()> kernel) {
+		kernels.push_back(std::make_pair(name, kernel));
+	};
+	std::vector<std::pair<std::string, randomx_argon2_impl*>> argonImpls = {
+		{ "reference", &randomx_argon2_fill_segment_ref },
+	};
+	if (randomx_argon2_impl_ssse3() != nullptr && cpu.hasSsse3())
+		argonImpls.push_back(std::make_pair("ssse3", randomx_argon2_impl_ssse3()));
+	if (randomx_argon2_impl_avx2() != nullptr && cpu.hasAvx2())
+		argonImpls.push_back(std::make_pair("avx2", randomx_argon2_impl_avx2()));
+	for (auto& impl : argonImpls) {
+		//each instance needs its own 256 MiB, allocated only if the kernel runs
+		auto fill = std::make_shared<std::unique_ptr<ArgonFill>>();
+		auto argonImpl = impl.second;
+		add("argon2_fill_memory_blocks " + impl.first, [fill, argonImpl]() {
+			if (!*fill)
+				fill->reset(new ArgonFill(argonImpl));
+			(**fill)();
+		});
+	}
+	std::vector<std::pair<std::string, bool>> aesModes = { { "soft", true } };
+	if (cpu.hasAes())
+		aesModes.push_back(std::make_pair("hard", false));
+	for (auto& mode : aesModes) {
+		bool soft = mode.second;
+		add("fillAes1Rx4 " + mode.first + " (2 MiB)", [&, soft]() {
+			soft ? fillAes1Rx4<true>(state, randomx::ScratchpadSize, scratchpad)
+				: fillAes1Rx4<false>(state, randomx::ScratchpadSize, scratchpad);
+		});
+		add("fillAes4Rx4 " + mode.first + " (program)", [&, soft]() {
+			soft ? fillAes4Rx4<true>(state, sizeof(program), &program)
+				: fillAes4Rx4<false>(state, sizeof(program), &program);
+		});
+		add("hashAes1Rx4 " + mode.first + " (2 MiB)", [&, soft]() {
+			soft ? hashAes1Rx4<true>(scratchpad, randomx::ScratchpadSize, hash)
+				: hashAes1Rx4<false>(scratchpad, randomx::ScratchpadSize, hash);
+		});
+	}
+	add("fillAes1Rx4 bitsliced (2 MiB)", [&]() { fillAes1Rx4Bitsliced(state, randomx::ScratchpadSize, scratchpad); });
+	add("hashAes1Rx4 bitsliced (2 MiB)", [&]() { hashAes1Rx4Bitsliced(scratchpad, randomx::ScratchpadSize, hash); });
+	add("generateSuperscalar", [&]() {
+		randomx::Blake2Generator gen(input, sizeof(input), nonce++);
+		randomx::generateSuperscalar(superscalar, gen);
+	});
+	add("executeSuperscalar", [&]() { randomx::executeSuperscalar(registers, cache->programs[0], &cache->reciprocalCache); });
+	add("initDatasetItem", [&]() {
+		randomx::initDatasetItem(cache, (uint8_t*)hash, itemNumber);
+		itemNumber = (itemNumber + 1) % randomx_dataset_item_count();
+	});
+#if RANDOMX_HAVE_COMPILER
+	randomx::JitCompiler jit;
+	add("JIT generateProgram", [&]() { jit.generateProgram(program, config); });
+#endif
+	add("blake2b (256 bytes)", [&]() { blake2b(hash, sizeof(hash), input, sizeof(input), nullptr, 0); input[0]++; });
+
+	std::cout << "Median and median absolute deviation of " << repetitions << " batches per kernel" << std::endl;
+	for (auto& kernel : kernels) {
+		if (kernel.first.find(filter) == std::string::npos)
+			continue;
+		Result result = measure(kernel.second, warmup, repetitions);
+		kernel.second = nullptr;
+		std::cout << " - " << std::left << std::setw(38) << kernel.first << std::right
+			<< std::setw(12) << formatTime(result.median) << " +- " << std::setw(10) << formatTime(result.mad)
+			<< "  (batch " << result.batch << ")" << std::endl;
+	}
+
+	randomx::DefaultAllocator::freeMemory(scratchpad, randomx::ScratchpadSize);
+	randomx_release_cache(cache);
+	return 0;
+}
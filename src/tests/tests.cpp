@@ -4,9 +4,14 @@
 
 #include <cassert>
 #include <iomanip>
+#include <vector>
+#include <cstring>
+#include <cfenv>
+#include <thread>
 #include "utility.hpp"
 #include "../bytecode_machine.hpp"
 #include "../dataset.hpp"
+#include "../argon2_core.h"
 #include "../blake2/endian.h"
 #include "../blake2/blake2.h"
 #include "../blake2_generator.hpp"
@@ -15,6 +20,13 @@
 #include "../intrin_portable.h"
 #include "../jit_compiler.hpp"
 #include "../aes_hash.hpp"
+#include "../cpu.hpp"
+#include "../virtual_machine.hpp"
+#if defined(__linux__)
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 randomx_cache* cache;
 randomx_vm* vm = nullptr;
@@ -78,6 +90,41 @@ int main() {
 		assert(cacheMemory[33554431] == 0x1f47f056d05cd99b);
 	});
 
+	runTest("Argon2 multi-lane fill", true, []() {
+		//4-lane instance filled serially and in parallel must give the same memory
+		constexpr uint32_t lanes = 4, blocks = 1024;
+		std::vector<block> serial(blocks), parallel(blocks);
+		const char key[] = "test key 000";
+		for (auto memory : { &serial, &parallel }) {
+			argon2_context context = {};
+			context.pwd = (uint8_t*)key;
+			context.pwdlen = (uint32_t)(sizeof(key) - 1);
+			context.salt = (uint8_t*)RANDOMX_ARGON_SALT;
+			context.saltlen = (uint32_t)randomx::ArgonSaltSize;
+			context.t_cost = RANDOMX_ARGON_ITERATIONS;
+			context.m_cost = blocks;
+			context.lanes = lanes;
+			context.threads = memory == &serial ? 1 : lanes;
+			context.flags = ARGON2_DEFAULT_FLAGS;
+			context.version = ARGON2_VERSION_NUMBER;
+			assert(randomx_argon2_validate_inputs(&context) == ARGON2_OK);
+			argon2_instance_t instance = {};
+			instance.version = context.version;
+			instance.passes = context.t_cost;
+			instance.memory_blocks = blocks;
+			instance.segment_length = blocks / (lanes * ARGON2_SYNC_POINTS);
+			instance.lane_length = instance.segment_length * ARGON2_SYNC_POINTS;
+			instance.lanes = lanes;
+			instance.threads = context.threads;
+			instance.type = Argon2_d;
+			instance.memory = memory->data();
+			instance.impl = &randomx_argon2_fill_segment_ref;
+			randomx_argon2_initialize(&instance, &context);
+			randomx::fillMemoryBlocks(&instance);
+		}
+		assert(memcmp(serial.data(), parallel.data(), blocks * sizeof(block)) == 0);
+	});
+
 	runTest("SuperscalarHash generator", RANDOMX_SUPERSCALAR_LATENCY == 170, []() {
 		char sprogHash[32];
 		randomx::SuperscalarProgram sprog;
@@ -105,6 +152,23 @@ int main() {
 		}
 	});
 
+	runTest("SuperscalarHash bytecode", true, []() {
+		const char key[] = "test key 000";
+		randomx::Blake2Generator gen(key, sizeof(key) - 1);
+		randomx::SuperscalarProgram sprog;
+		std::vector<randomx::SuperscalarBytecode> bytecode;
+		uint64_t r[8], rb[8];
+		for (int i = 0; i < 64; ++i) {
+			randomx::generateSuperscalar(sprog, gen);
+			randomx::compileSuperscalarBytecode(sprog, bytecode);
+			blake2b(r, sizeof(r), &i, sizeof(i), nullptr, 0);
+			memcpy(rb, r, sizeof(r));
+			randomx::executeSuperscalar(r, sprog);
+			randomx::executeSuperscalarBytecode(rb, bytecode.data());
+			assert(memcmp(r, rb, sizeof(r)) == 0);
+		}
+	});
+
 	runTest("randomx_reciprocal", true, []() {
 		assert(randomx_reciprocal(3) == 12297829382473034410U);
 		assert(randomx_reciprocal(13) == 11351842506898185609U);
@@ -159,6 +223,32 @@ int main() {
 		assert(datasetItem[0] == 0x145a5091f7853099);
 	});
 
+	runTest("Dataset prefetch modes (compiler)", RANDOMX_HAVE_COMPILER, []() {
+		alignas(16) uint64_t seed[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+		alignas(64) randomx::Program program;
+		randomx::ProgramConfiguration config = {};
+		fillAes4Rx4<true>(seed, sizeof(program), &program);
+		randomx::JitCompiler reference;
+		reference.generateProgram(program, config);
+		for (int mode = RANDOMX_PREFETCH_T0; mode < RANDOMX_PREFETCH_MODES; ++mode) {
+			randomx::JitCompiler jit;
+			jit.setPrefetchMode((randomx_prefetch_mode)mode);
+			jit.generateProgram(program, config);
+			//only the prefetch instruction may differ
+			size_t first = SIZE_MAX, last = 0;
+			for (size_t i = 0; i < jit.getCodeSize(); ++i) {
+				if (jit.getCode()[i] != reference.getCode()[i]) {
+					first = std::min(first, i);
+					last = i;
+				}
+			}
+			assert(first == SIZE_MAX || last - first < 4);
+#if defined(_M_X64) || defined(__x86_64__)
+			assert(first != SIZE_MAX);
+#endif
+		}
+	});
+
 	runTest("AesGenerator1R", true, []() {
 		char state[64] = { 0 };
 		hex2bin("6c19536eb2de31b6c0065f7f116e86f960d8af0c57210a6584c3237b9d064dc7", 64, state);
@@ -166,6 +256,40 @@ int main() {
 		assert(equalsHex(state, "fa89397dd6ca422513aeadba3f124b5540324c4ad4b6db434394307a17c833ab"));
 	});
 
+	runTest("AesGenerator1R (bitsliced)", true, []() {
+		char state[64] = { 0 };
+		hex2bin("6c19536eb2de31b6c0065f7f116e86f960d8af0c57210a6584c3237b9d064dc7", 64, state);
+		fillAes1Rx4Bitsliced(state, sizeof(state), state);
+		assert(equalsHex(state, "fa89397dd6ca422513aeadba3f124b5540324c4ad4b6db434394307a17c833ab"));
+	});
+
+	runTest("Bitsliced software AES", true, []() {
+		const size_t size = 16 * 1024;
+		std::vector<uint8_t> buffer(size), expected(size);
+		alignas(16) uint64_t state[8], expectedState[8], hash[8], expectedHash[8];
+		blake2b(state, sizeof(state), "bitsliced", 9, nullptr, 0);
+		memcpy(expectedState, state, sizeof(state));
+
+		fillAes1Rx4Bitsliced(state, size, buffer.data());
+		fillAes1Rx4<true>(expectedState, size, expected.data());
+		assert(buffer == expected);
+		assert(memcmp(state, expectedState, sizeof(state)) == 0);
+
+		hashAes1Rx4Bitsliced(buffer.data(), size, hash);
+		hashAes1Rx4<true>(expected.data(), size, expectedHash);
+		assert(memcmp(hash, expectedHash, sizeof(hash)) == 0);
+
+		fillAes4Rx4Bitsliced(state, size, buffer.data());
+		fillAes4Rx4<true>(expectedState, size, expected.data());
+		assert(buffer == expected);
+
+		hashAndFillAes1Rx4Bitsliced(buffer.data(), size, hash, state);
+		hashAndFillAes1Rx4<true>(expected.data(), size, expectedHash, expectedState);
+		assert(buffer == expected);
+		assert(memcmp(state, expectedState, sizeof(state)) == 0);
+		assert(memcmp(hash, expectedHash, sizeof(hash)) == 0);
+	});
+
 	randomx::NativeRegisterFile reg;
 	randomx::BytecodeMachine decoder;
 	randomx::InstructionByteCode ibc;
@@ -1026,6 +1150,22 @@ int main() {
 
 	runTest("Hash test 2e (compiler)", RANDOMX_HAVE_COMPILER && stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), test_e);
 
+	runTest("Light mode next item prefetch (compiler)", RANDOMX_HAVE_COMPILER, []() {
+		//hashes of light JIT programs must not depend on the prefetch of the next item
+		randomx_vm* prefetching = randomx_create_vm(RANDOMX_FLAG_JIT, cache, nullptr);
+		randomx_vm* plain = randomx_create_vm(RANDOMX_FLAG_JIT, cache, nullptr);
+		assert(prefetching != nullptr && plain != nullptr);
+		randomx_vm_set_prefetch_mode(plain, RANDOMX_PREFETCH_NONE);
+		for (uint32_t nonce = 0; nonce < 4; ++nonce) {
+			char hash1[RANDOMX_HASH_SIZE], hash2[RANDOMX_HASH_SIZE];
+			randomx_calculate_hash(prefetching, &nonce, sizeof(nonce), hash1);
+			randomx_calculate_hash(plain, &nonce, sizeof(nonce), hash2);
+			assert(memcmp(hash1, hash2, sizeof(hash1)) == 0);
+		}
+		randomx_destroy_vm(prefetching);
+		randomx_destroy_vm(plain);
+	});
+
 	auto flags = randomx_get_flags();
 
 	randomx_release_cache(cache);
@@ -1055,6 +1195,144 @@ int main() {
 		randomx_release_cache(cache);
 	cache = randomx_alloc_cache(RANDOMX_FLAG_DEFAULT);
 
+	runTest("Threaded interpreter", RANDOMX_HAVE_THREADED_INTERPRETER, []() {
+		alignas(16) randomx::ProgramConfiguration config;
+		randomx::NativeRegisterFile nreg, nregInit, nregSwitch;
+		randomx::InstructionByteCode bytecode[randomx::BytecodeSize];
+		randomx::BytecodeMachine machine;
+		randomx::Program program;
+		std::vector<uint8_t> scratchpad(randomx::ScratchpadSize);
+		std::vector<uint8_t> scratchpadInit, scratchpadSwitch;
+		alignas(16) uint64_t seed[8];
+		uint64_t dispatchesSaved = 0;
+		fenv_t floatEnv;
+		fegetenv(&floatEnv);
+		config.eMask[0] = 0x3a0000000000000f;
+		config.eMask[1] = 0x3b000000000000f0;
+		for (uint32_t nonce = 0; nonce < 64; ++nonce) {
+			blake2b(seed, sizeof(seed), &nonce, sizeof(nonce), nullptr, 0);
+			fillAes4Rx4<true>(seed, sizeof(program), &program);
+			fillAes1Rx4<true>(seed, randomx::ScratchpadSize, scratchpad.data());
+			for (unsigned i = 0; i < randomx::RegistersCount; ++i)
+				nreg.r[i] = load64(scratchpad.data() + 8 * i);
+			for (unsigned i = 0; i < randomx::RegisterCountFlt; ++i) {
+				nreg.f[i] = rx_cvt_packed_int_vec_f128(scratchpad.data() + 64 + 8 * i);
+				nreg.e[i] = rx_cvt_packed_int_vec_f128(scratchpad.data() + 96 + 8 * i);
+				nreg.a[i] = rx_cvt_packed_int_vec_f128(scratchpad.data() + 128 + 8 * i);
+			}
+			nregInit = nreg;
+			scratchpadInit = scratchpad;
+			machine.compileProgram(program, bytecode, nreg);
+			rx_reset_float_state();
+			for (int ic = 0; ic < 16; ++ic)
+				randomx::BytecodeMachine::executeBytecode(bytecode, scratchpad.data(), config);
+			nregSwitch = nreg;
+			scratchpadSwitch = scratchpad;
+			nreg = nregInit;
+			scratchpad = scratchpadInit;
+			rx_reset_float_state();
+			for (int ic = 0; ic < 16; ++ic)
+				dispatchesSaved += randomx::BytecodeMachine::executeBytecodeThreaded(bytecode, scratchpad.data(), config);
+			assert(memcmp(&nreg, &nregSwitch, sizeof(nreg)) == 0);
+			assert(scratchpad == scratchpadSwitch);
+		}
+		assert(dispatchesSaved > 0);
+		fesetenv(&floatEnv);
+	});
+
+	randomx::Cpu cpu;
+
+	runTest("AES multi-buffer", hasVaesKernels() && cpu.hasAes() && cpu.hasVaes() && cpu.hasAvx512(), []() {
+		const size_t size = 64 * 1024;
+		std::vector<uint8_t> buffers(4 * size), expected(4 * size);
+		alignas(16) uint64_t states[4][8], expectedStates[4][8], hashes[4][8], expectedHashes[4][8];
+		for (unsigned count = 2; count <= 4; count += 2) {
+			void* bufferPtrs[4];
+			void* statePtrs[4];
+			void* hashPtrs[4];
+			for (unsigned i = 0; i < count; ++i) {
+				blake2b(states[i], sizeof(states[i]), &i, sizeof(i), &count, sizeof(count));
+				memcpy(expectedStates[i], states[i], sizeof(states[i]));
+				bufferPtrs[i] = &buffers[i * size];
+				statePtrs[i] = states[i];
+				hashPtrs[i] = hashes[i];
+				fillAes1Rx4<false>(expectedStates[i], size, &expected[i * size]);
+				hashAes1Rx4<false>(&expected[i * size], size, expectedHashes[i]);
+			}
+			fillAes1Rx4Vaes(count, statePtrs, size, bufferPtrs);
+			hashAes1Rx4Vaes(count, bufferPtrs, size, hashPtrs);
+			assert(memcmp(buffers.data(), expected.data(), count * size) == 0);
+			assert(memcmp(states, expectedStates, count * sizeof(states[0])) == 0);
+			assert(memcmp(hashes, expectedHashes, count * sizeof(hashes[0])) == 0);
+			for (unsigned i = 0; i < count; ++i)
+				hashAndFillAes1Rx4<false>(&expected[i * size], size, expectedHashes[i], expectedStates[i]);
+			hashAndFillAes1Rx4Vaes(count, bufferPtrs, size, hashPtrs, statePtrs);
+			assert(memcmp(buffers.data(), expected.data(), count * size) == 0);
+			assert(memcmp(states, expectedStates, count * sizeof(states[0])) == 0);
+			assert(memcmp(hashes, expectedHashes, count * sizeof(hashes[0])) == 0);
+		}
+	});
+
+	runTest("Blake2b SIMD", randomx_blake2b_compress_avx2() != nullptr && cpu.hasAvx2(), [&]() {
+		const size_t sizes[] = { 0, 1, 64, 127, 128, 129, 256, 300 };
+		std::vector<uint8_t> input(9 * 300);
+		for (size_t i = 0; i < input.size(); ++i)
+			input[i] = (uint8_t)(i * 7 + 3);
+		uint8_t expected[9][64], hashes[9][64];
+		for (size_t outlen = 32; outlen <= 64; outlen += 32) {
+			for (size_t size : sizes) {
+				const void* inputs[9];
+				void* outputs[9];
+				randomx_blake2b_select_impl(0, 0);
+				for (unsigned i = 0; i < 9; ++i) {
+					inputs[i] = &input[i * 300];
+					outputs[i] = hashes[i];
+					blake2b(expected[i], outlen, inputs[i], size, nullptr, 0);
+				}
+				randomx_blake2b_select_impl(cpu.hasAvx2(), cpu.hasAvx512());
+				for (unsigned i = 0; i < 9; ++i) {
+					blake2b(hashes[i], outlen, inputs[i], size, nullptr, 0);
+					assert(memcmp(hashes[i], expected[i], outlen) == 0);
+				}
+				for (unsigned count = 1; count <= 9; ++count) {
+					memset(hashes, 0, sizeof(hashes));
+					assert(blake2b_many(outputs, outlen, inputs, size, count) == 0);
+					for (unsigned i = 0; i < count; ++i)
+						assert(memcmp(hashes[i], expected[i], outlen) == 0);
+				}
+			}
+		}
+	});
+
+	runTest("Hash multi test", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), [&]() {
+		initCache("test key 000");
+		randomx_vm* machines[5];
+		for (int i = 0; i < 5; ++i) {
+			machines[i] = randomx_create_vm(flags & RANDOMX_FLAG_HARD_AES, cache, nullptr);
+			assert(machines[i] != nullptr);
+		}
+		const char* strings[] = { "This is a test", "Lorem ipsum dolor sit amet", "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua" };
+		const void* inputs[5];
+		size_t inputSizes[5];
+		char hashes[5][RANDOMX_HASH_SIZE];
+		void* outputs[5];
+		for (int i = 0; i < 5; ++i) {
+			inputs[i] = strings[i % 3];
+			inputSizes[i] = strlen(strings[i % 3]);
+			outputs[i] = hashes[i];
+		}
+
+		randomx_calculate_hash_multi(machines, inputs, inputSizes, outputs, 5);
+
+		for (int i = 0; i < 5; ++i)
+			randomx_destroy_vm(machines[i]);
+		assert(equalsHex(hashes[0], "639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f"));
+		assert(equalsHex(hashes[1], "300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969"));
+		assert(equalsHex(hashes[2], "c36d4ed4191e617309867ed66a443be4075014e2b061bcdaf9ce7b721d2b77a8"));
+		assert(equalsHex(hashes[3], "639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f"));
+		assert(equalsHex(hashes[4], "300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969"));
+	});
+
 	runTest("Hash batch test", RANDOMX_HAVE_COMPILER && stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
 		char hash1[RANDOMX_HASH_SIZE];
 		char hash2[RANDOMX_HASH_SIZE];
@@ -1074,6 +1352,380 @@ int main() {
 		assert(equalsHex(hash3, "c36d4ed4191e617309867ed66a443be4075014e2b061bcdaf9ce7b721d2b77a8"));
 	});
 
+	runTest("Hash batch API", RANDOMX_HAVE_COMPILER && stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		initCache("test key 000");
+		const char* strings[] = { "This is a test", "Lorem ipsum dolor sit amet", "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua" };
+		const void* inputs[4];
+		size_t inputSizes[4];
+		char hashes[4][RANDOMX_HASH_SIZE];
+		void* outputs[4];
+		for (int i = 0; i < 4; ++i) {
+			inputs[i] = strings[i % 3];
+			inputSizes[i] = strlen(strings[i % 3]);
+			outputs[i] = hashes[i];
+		}
+		rx_set_rounding_mode(RoundToNearest);
+		randomx_calculate_hash_batch(vm, inputs, inputSizes, outputs, 4);
+		assert(rx_get_rounding_mode() == RoundToNearest);
+		assert(equalsHex(hashes[0], "639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f"));
+		assert(equalsHex(hashes[1], "300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969"));
+		assert(equalsHex(hashes[2], "c36d4ed4191e617309867ed66a443be4075014e2b061bcdaf9ce7b721d2b77a8"));
+		assert(equalsHex(hashes[3], "639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f"));
+		randomx_calculate_hash_batch(vm, inputs + 1, inputSizes + 1, outputs, 1);
+		assert(equalsHex(hashes[0], "300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969"));
+	});
+
+	runTest("Hashing engine", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		//one cached key: switching between the two keys releases and reinitializes caches
+		//interpreted VMs, the reference vectors do not apply to light-mode JIT VMs in this tree
+		randomx_flags engineFlags = (randomx_flags)(randomx_get_flags() & ~RANDOMX_FLAG_JIT);
+		randomx_engine* engine = randomx_create_engine(engineFlags, 2, 1);
+		assert(engine != nullptr);
+		const char* strings[] = { "This is a test", "Lorem ipsum dolor sit amet", "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua" };
+		const char* keys[] = { "test key 000", "test key 000", "test key 000", "test key 001", "test key 000" };
+		const char expected[5][65] = {
+			"639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f",
+			"300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969",
+			"c36d4ed4191e617309867ed66a443be4075014e2b061bcdaf9ce7b721d2b77a8",
+			"e9ff4503201c0c2cca26d285c93ae883f9b1d30c9eb240b820756f2d5a7905fc",
+			"639183aae1bf4c9a35884cb46b09cad9175f04efd7684e7262a0ac1c2f0b4e3f",
+		};
+		const int inputIndex[] = { 0, 1, 2, 2, 0 };
+		for (int i = 0; i < 5; ++i) {
+			const char* input = strings[inputIndex[i]];
+			assert(randomx_engine_submit(engine, keys[i], strlen(keys[i]), input, strlen(input), 100 + i) == 1);
+		}
+		bool done[5] = {};
+		unsigned completed = 0;
+		randomx_engine_result results[5];
+		while (completed < 5) {
+			unsigned count = randomx_engine_wait(engine, results, 5, 1000);
+			for (unsigned i = 0; i < count; ++i) {
+				int job = (int)(results[i].user_data - 100);
+				assert(job >= 0 && job < 5 && !done[job]);
+				assert(results[i].status == 1);
+				assert(equalsHex(results[i].hash, expected[job]));
+				done[job] = true;
+			}
+			completed += count;
+		}
+		assert(randomx_engine_poll(engine, results, 5) == 0);
+#if defined(__linux__)
+		int fd = randomx_engine_fd(engine);
+		assert(fd >= 0);
+		assert(randomx_engine_submit(engine, keys[0], strlen(keys[0]), strings[1], strlen(strings[1]), 7) == 1);
+		pollfd pfd = { fd, POLLIN, 0 };
+		assert(poll(&pfd, 1, 60000) == 1);
+		assert(randomx_engine_poll(engine, results, 5) == 1);
+		assert(results[0].user_data == 7 && equalsHex(results[0].hash, expected[1]));
+		pfd.revents = 0;
+		assert(poll(&pfd, 1, 0) == 0);
+#endif
+		randomx_destroy_engine(engine);
+	});
+
+	runTest("Scratchpad arena", RANDOMX_HAVE_COMPILER && stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		initCache("test key 000");
+		randomx_flags arenaFlags = (randomx_flags)(RANDOMX_FLAG_JIT | RANDOMX_FLAG_LARGE_PAGES | RANDOMX_FLAG_SCRATCHPAD_ARENA);
+		for (unsigned colours = 1; colours <= 2; ++colours) {
+			randomx_set_scratchpad_colours(colours);
+			randomx_vm* machines[3];
+			for (int i = 0; i < 3; ++i) {
+				machines[i] = randomx_create_vm(arenaFlags, cache, nullptr);
+				if (machines[i] == nullptr) {
+					//no large pages on this host
+					while (i-- > 0)
+						randomx_destroy_vm(machines[i]);
+					return;
+				}
+			}
+			auto sp0 = (const uint8_t*)machines[0]->getScratchpad();
+			auto sp1 = (const uint8_t*)machines[1]->getScratchpad();
+			auto sp2 = (const uint8_t*)machines[2]->getScratchpad();
+			//regions grow lazily, so the scratchpads need not be adjacent, but must not overlap
+			const uint8_t* sp[3] = { sp0, sp1, sp2 };
+			for (int i = 0; i < 3; ++i) {
+				for (int j = i + 1; j < 3; ++j)
+					assert(sp[i] + randomx::ScratchpadSize <= sp[j] || sp[j] + randomx::ScratchpadSize <= sp[i]);
+				//slots are large page aligned, colours are cache-line offsets below 4 KiB
+				assert((uintptr_t)sp[i] % (2 * 1024 * 1024) == (i % colours) * 256);
+			}
+			char hash[RANDOMX_HASH_SIZE], expected[RANDOMX_HASH_SIZE];
+			randomx_vm* reference = randomx_create_vm(RANDOMX_FLAG_JIT, cache, nullptr);
+			assert(reference != nullptr);
+			randomx_calculate_hash(reference, "Lorem ipsum dolor sit amet", 26, &expected);
+			randomx_destroy_vm(reference);
+			randomx_calculate_hash(machines[1], "Lorem ipsum dolor sit amet", 26, &hash);
+			assert(memcmp(hash, expected, sizeof(hash)) == 0);
+			for (int i = 0; i < 3; ++i)
+				randomx_destroy_vm(machines[i]);
+		}
+		randomx_set_scratchpad_colours(1);
+	});
+
+	randomx_page_info pageInfo;
+	runTest("Page info", randomx_cache_page_info(cache, &pageInfo) != 0, [&]() {
+		assert(pageInfo.size == randomx::CacheSize);
+		assert(pageInfo.page_size >= 4096);
+		assert(pageInfo.resident_bytes > 0);
+		assert(pageInfo.thp_bytes + pageInfo.hugetlb_bytes <= pageInfo.resident_bytes);
+		assert(randomx_scratchpad_page_info(vm, &pageInfo) != 0);
+		assert(pageInfo.size == randomx::ScratchpadSize);
+	});
+
+	runTest("Dataset first touch", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03") && randomx_cache_page_info(cache, &pageInfo) != 0, []() {
+		randomx_dataset* dataset = randomx_alloc_dataset(RANDOMX_FLAG_LARGE_PAGES | RANDOMX_FLAG_FIRST_TOUCH);
+		if (dataset == nullptr)
+			return;
+		randomx_page_info info;
+		assert(randomx_dataset_page_info(dataset, &info) != 0);
+		assert(info.resident_bytes < info.size / 2);
+		initCache("test key 000");
+		randomx_init_dataset(dataset, cache, 0, 1);
+		uint64_t* datasetMemory = (uint64_t*)randomx_get_dataset_memory(dataset);
+		assert(datasetMemory[0] == 0x680588a85ae222db);
+		assert(randomx_dataset_page_info(dataset, &info) != 0);
+		assert(info.resident_bytes > 0);
+		randomx_release_dataset(dataset);
+	});
+
+	runTest("Shared dataset", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		const char* name = "tests-shared-dataset";
+		randomx_unlink_dataset_shared(name);
+		assert(randomx_alloc_dataset_shared("a/b", RANDOMX_FLAG_DEFAULT) == nullptr);
+		randomx_dataset* filler = randomx_alloc_dataset_shared(name, RANDOMX_FLAG_DEFAULT);
+		if (filler == nullptr)
+			return;
+		randomx_dataset* reader = randomx_alloc_dataset_shared(name, RANDOMX_FLAG_DEFAULT);
+		assert(reader != nullptr);
+		assert(randomx_get_dataset_memory(reader) != randomx_get_dataset_memory(filler));
+		initCache("test key 000");
+		assert(randomx_begin_dataset_init(filler, "test key 000", 12) == 1);
+		randomx_init_dataset(filler, cache, 0, 1);
+		randomx_end_dataset_init(filler);
+		assert(randomx_begin_dataset_init(reader, "test key 000", 12) == 0);
+		assert(randomx_dataset_ready(reader));
+		uint64_t* datasetMemory = (uint64_t*)randomx_get_dataset_memory(reader);
+		assert(datasetMemory[0] == 0x680588a85ae222db);
+		//switching keys waits until the other user of the old contents switches too
+		auto switchKey = [](randomx_dataset* dataset) {
+			int fill = randomx_begin_dataset_init(dataset, "test key 001", 12);
+			if (fill)
+				randomx_end_dataset_init(dataset);
+			return fill;
+		};
+		int readerFilled = 0;
+		std::thread readerThread([&]() { readerFilled = switchKey(reader); });
+		int fillerFilled = switchKey(filler);
+		readerThread.join();
+		assert(readerFilled + fillerFilled == 1);
+		assert(randomx_dataset_ready(reader) && randomx_dataset_ready(filler));
+		//a process that did not claim the current contents must not use them
+		randomx_dataset* late = randomx_alloc_dataset_shared(name, RANDOMX_FLAG_DEFAULT);
+		assert(late != nullptr && !randomx_dataset_ready(late));
+		assert(randomx_begin_dataset_init(late, "test key 001", 12) == 0);
+		assert(randomx_dataset_ready(late));
+		//a key switch gives up while another process keeps using the old key
+		assert(randomx_begin_dataset_init(filler, "test key 002", 12) == -1);
+		assert(!randomx_dataset_ready(filler) && randomx_dataset_ready(late) && randomx_dataset_ready(reader));
+		randomx_release_dataset(late);
+		randomx_release_dataset(reader);
+		randomx_release_dataset(filler);
+		assert(randomx_unlink_dataset_shared(name) == 1);
+	});
+
+	runTest("Shared dataset creation race", true, []() {
+#if defined(__linux__)
+		const char* name = "tests-shared-race";
+		for (int round = 0; round < 200; ++round) {
+			randomx_unlink_dataset_shared(name);
+			//two processes create the object at the same time (in hugetlbfs if huge pages are reserved)
+			int start[2];
+			assert(pipe(start) == 0);
+			pid_t children[2];
+			for (int i = 0; i < 2; ++i) {
+				children[i] = fork();
+				assert(children[i] >= 0);
+				if (children[i] == 0) {
+					char c;
+					if (read(start[0], &c, 1) != 1)
+						_exit(1);
+					randomx_dataset* dataset = randomx_alloc_dataset_shared(name, RANDOMX_FLAG_LARGE_PAGES);
+					if (dataset == nullptr)
+						_exit(1);
+					((uint8_t*)randomx_get_dataset_memory(dataset))[i] = 1;
+					_exit(0);
+				}
+			}
+			close(start[0]);
+			assert(write(start[1], "go", 2) == 2);
+			close(start[1]);
+			for (int i = 0; i < 2; ++i) {
+				int status;
+				assert(waitpid(children[i], &status, 0) == children[i]);
+				assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+			}
+			//both processes must have mapped the same object
+			randomx_dataset* dataset = randomx_alloc_dataset_shared(name, RANDOMX_FLAG_DEFAULT);
+			assert(dataset != nullptr);
+			uint8_t* datasetMemory = (uint8_t*)randomx_get_dataset_memory(dataset);
+			assert(datasetMemory[0] == 1 && datasetMemory[1] == 1);
+			randomx_release_dataset(dataset);
+		}
+		assert(randomx_unlink_dataset_shared(name) == 1);
+#endif
+	});
+
+	runTest("Lazy dataset", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		randomx_dataset* dataset = randomx_alloc_dataset(RANDOMX_FLAG_DEFAULT);
+		assert(dataset != nullptr);
+		initCache("test key 000");
+		if (!randomx_init_dataset_lazy(dataset, cache, 0)) {
+			randomx_release_dataset(dataset);
+			return;
+		}
+		assert(!randomx_dataset_ready(dataset));
+		uint64_t* datasetMemory = (uint64_t*)randomx_get_dataset_memory(dataset);
+		assert(datasetMemory[0] == 0x680588a85ae222db);
+		const unsigned long items[] = { 1, 10000000, 34078718, randomx_dataset_item_count() - 1 };
+		for (unsigned long item : items) {
+			uint64_t expected[8];
+			randomx::initDatasetItem(cache, (uint8_t*)expected, item);
+			assert(memcmp(datasetMemory + 8 * item, expected, sizeof(expected)) == 0);
+		}
+		randomx_release_dataset(dataset);
+		//without background threads, the remaining pages are filled by randomx_wait_dataset
+		const unsigned long partialItems = 100000;
+		dataset = randomx_alloc_dataset_partial(RANDOMX_FLAG_DEFAULT, partialItems);
+		assert(dataset != nullptr && randomx_init_dataset_lazy(dataset, cache, 0));
+		assert(randomx_wait_dataset(dataset) == 1 && randomx_dataset_ready(dataset));
+		datasetMemory = (uint64_t*)randomx_get_dataset_memory(dataset);
+		for (unsigned long item = 0; item < partialItems; item += 997) {
+			uint64_t expected[8];
+			randomx::initDatasetItem(cache, (uint8_t*)expected, item);
+			assert(memcmp(datasetMemory + 8 * item, expected, sizeof(expected)) == 0);
+		}
+		randomx_release_dataset(dataset);
+	});
+
+	runTest("Partial dataset", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		const unsigned long prefixItems = 100000;
+		randomx_dataset* dataset = randomx_alloc_dataset_partial(RANDOMX_FLAG_DEFAULT, prefixItems);
+		assert(dataset != nullptr);
+		assert(randomx_alloc_dataset_partial(RANDOMX_FLAG_DEFAULT, randomx_dataset_item_count() + 1) == nullptr);
+		initCache("test key 000");
+		randomx_init_dataset(dataset, cache, 0, prefixItems);
+		const randomx_flags modes[] = { RANDOMX_FLAG_DEFAULT, RANDOMX_FLAG_JIT };
+		for (randomx_flags mode : modes) {
+			if ((mode & RANDOMX_FLAG_JIT) && !RANDOMX_HAVE_COMPILER)
+				continue;
+			assert(randomx_create_vm((randomx_flags)(mode | RANDOMX_FLAG_FULL_MEM), nullptr, dataset) == nullptr);
+			randomx_vm* hybrid = randomx_create_vm((randomx_flags)(mode | RANDOMX_FLAG_FULL_MEM), cache, dataset);
+			randomx_vm* light = randomx_create_vm(mode, cache, nullptr);
+			assert(hybrid != nullptr && light != nullptr);
+			char hash[RANDOMX_HASH_SIZE], expected[RANDOMX_HASH_SIZE];
+			randomx_calculate_hash(light, "Lorem ipsum dolor sit amet", 26, &expected);
+			randomx_calculate_hash(hybrid, "Lorem ipsum dolor sit amet", 26, &hash);
+			assert(memcmp(hash, expected, sizeof(hash)) == 0);
+			//the precomputed items must actually be used
+			uint8_t* datasetMemory = (uint8_t*)randomx_get_dataset_memory(dataset);
+			for (unsigned long i = 0; i < prefixItems; ++i)
+				datasetMemory[i * RANDOMX_DATASET_ITEM_SIZE] ^= 1;
+			randomx_calculate_hash(hybrid, "Lorem ipsum dolor sit amet", 26, &hash);
+			assert(memcmp(hash, expected, sizeof(hash)) != 0);
+			for (unsigned long i = 0; i < prefixItems; ++i)
+				datasetMemory[i * RANDOMX_DATASET_ITEM_SIZE] ^= 1;
+			randomx_destroy_vm(hybrid);
+			randomx_destroy_vm(light);
+		}
+		randomx_release_dataset(dataset);
+	});
+
+	runTest("Phase profile", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		initCache("test key 000");
+		randomx_vm* machine = randomx_create_vm(RANDOMX_FLAG_DEFAULT, cache, nullptr);
+		randomx_profile profile;
+		char hash[RANDOMX_HASH_SIZE];
+		randomx_calculate_hash(machine, "Lorem ipsum dolor sit amet", 26, &hash);
+		randomx_calculate_hash_first(machine, "Lorem ipsum dolor sit amet", 26);
+		randomx_calculate_hash_last(machine, &hash);
+#ifdef RANDOMX_PROFILE
+		assert(randomx_get_profile(machine, &profile) == 1);
+		assert(profile.hashes == 2);
+		assert(profile.fill_scratchpad > 0 && profile.generate_program > 0 && profile.compile > 0);
+		assert(profile.execute > 0 && profile.blake2b_hash > 0 && profile.final_hash > 0);
+		randomx_reset_profile(machine);
+		assert(randomx_get_profile(machine, &profile) == 1 && profile.hashes == 0 && profile.execute == 0);
+#else
+		assert(randomx_get_profile(machine, &profile) == 0);
+		assert(profile.hashes == 0 && profile.execute == 0);
+#endif
+		randomx_destroy_vm(machine);
+	});
+
+	runTest("Perf counters", stringsEqual(RANDOMX_ARGON_SALT, "RandomX\x03"), []() {
+		initCache("test key 000");
+		randomx_vm* machine = randomx_create_vm(RANDOMX_FLAG_DEFAULT, cache, nullptr);
+		randomx_perf_counters counters;
+		assert(randomx_vm_get_perf_counters(machine, &counters) == 0);
+		int available = randomx_vm_enable_perf_counters(machine);
+		char hash[RANDOMX_HASH_SIZE];
+		randomx_calculate_hash(machine, "Lorem ipsum dolor sit amet", 26, &hash);
+		assert(equalsHex(hash, "300a0adb47603dedb42228ccb2b211104f4da45af709cd7547cd049e9489c969"));
+		//hardware counters are often unavailable (virtual machines, perf_event_paranoid)
+		if (available > 0) {
+			assert(randomx_vm_get_perf_counters(machine, &counters) == 1);
+			assert(counters.hashes == 1);
+			randomx_vm_reset_perf_counters(machine);
+			assert(randomx_vm_get_perf_counters(machine, &counters) == 1 && counters.hashes == 0);
+		}
+		else {
+			assert(randomx_vm_get_perf_counters(machine, &counters) == 0);
+		}
+		randomx_destroy_vm(machine);
+	});
+
+	runTest("CPU info", true, []() {
+		randomx::Cpu cpu;
+		randomx_cpu_info info;
+		randomx_get_cpu_info(&info);
+		assert(info.aes == cpu.hasAes() && info.avx2 == cpu.hasAvx2() && info.bmi2 == cpu.hasBmi2());
+		assert(strcmp(info.brand, cpu.brand()) == 0);
+		assert(info.vendor != RANDOMX_CPU_VENDOR_UNKNOWN || cpu.vendor() == randomx::CpuVendorUnknown);
+		assert(info.threads_per_core >= 1);
+		if (info.logical_cpus != 0) {
+			assert(info.threads_per_core <= info.logical_cpus);
+			assert(info.threads_per_l3 <= info.logical_cpus);
+		}
+		if (info.l2_size != 0 && info.l3_size != 0)
+			assert(info.threads_per_l3 == 0 || info.threads_per_l3 >= info.threads_per_l2);
+	});
+
+	runTest("Tuning profile", true, []() {
+		const char* dir = getenv("TMPDIR");
+		if (dir == nullptr)
+			dir = getenv("TEMP");
+		const std::string file = std::string(dir != nullptr ? dir : "/tmp") + "/randomx-tuning-test.tmp";
+		const char* path = file.c_str();
+		std::remove(path);
+		randomx_tuning tuning, loaded;
+		assert(randomx_load_tuning(path, &loaded) == 0);
+		tuning.flags = RANDOMX_FLAG_JIT | RANDOMX_FLAG_LARGE_PAGES;
+		tuning.threads = 3;
+		tuning.init_threads = 2;
+		tuning.affinity = 0;
+		tuning.hashrate = 1234.5;
+		tuning.full_mem = 1;
+		assert(randomx_save_tuning(path, &tuning) == 1);
+		tuning.threads = 4;
+		assert(randomx_save_tuning(path, &tuning) == 1);
+		assert(randomx_load_tuning(path, &loaded) == 1);
+		assert(loaded.flags == tuning.flags);
+		assert(loaded.threads == 4 && loaded.init_threads == 2);
+		assert(loaded.hashrate == 1234.5 && loaded.full_mem == 1);
+		std::remove(path);
+	});
+
 	runTest("Preserve rounding mode", RANDOMX_FREQ_CFROUND > 0, []() {
 		rx_set_rounding_mode(RoundToNearest);
 		char hash[RANDOMX_HASH_SIZE];
@@ -35,9 +35,28 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "blake2/blake2.h"
 #include "intrin_portable.h"
 #include "allocator.hpp"
+#include "perf_counters.hpp"
 
 randomx_vm::~randomx_vm() {
+	delete perf;
+}
 
+void randomx_vm::prefetchDataset(uint8_t* address) {
+	switch (prefetchMode) {
+		case RANDOMX_PREFETCH_T0:
+			rx_prefetch_t0(address);
+			break;
+		case RANDOMX_PREFETCH_T1:
+			rx_prefetch_t1(address);
+			break;
+		case RANDOMX_PREFETCH_T2:
+			rx_prefetch_t2(address);
+			break;
+		case RANDOMX_PREFETCH_NONE:
+			break;
+		default:
+			rx_prefetch_nta(address);
+	}
 }
 
 void randomx_vm::resetRoundingMode() {
@@ -116,28 +135,54 @@ namespace randomx {
 
 	template<class Allocator, bool softAes>
 	void VmBase<Allocator, softAes>::getFinalResult(void* out, size_t outSize) {
-		hashAes1Rx4<softAes>(scratchpad, ScratchpadSize, &reg.a);
+		RANDOMX_PROFILE_HASH(this);
+		{
+			RANDOMX_PROFILE_SCOPE(this, ProfileFinalHash);
+			if (softAes && bitsliceAes)
+				hashAes1Rx4Bitsliced(scratchpad, ScratchpadSize, &reg.a);
+			else
+				hashAes1Rx4<softAes>(scratchpad, ScratchpadSize, &reg.a);
+		}
+		RANDOMX_PROFILE_SCOPE(this, ProfileBlake2b);
 		blake2b(out, outSize, &reg, sizeof(RegisterFile), nullptr, 0);
 	}
 
 	template<class Allocator, bool softAes>
 	void VmBase<Allocator, softAes>::hashAndFill(void* out, size_t outSize, uint64_t *fill_state) {
-		hashAndFillAes1Rx4<softAes>((void*) getScratchpad(), ScratchpadSize, &reg.a, fill_state);
+		RANDOMX_PROFILE_HASH(this);
+		{
+			RANDOMX_PROFILE_SCOPE(this, ProfileFinalHash);
+			if (softAes && bitsliceAes)
+				hashAndFillAes1Rx4Bitsliced((void*) getScratchpad(), ScratchpadSize, &reg.a, fill_state);
+			else
+				hashAndFillAes1Rx4<softAes>((void*) getScratchpad(), ScratchpadSize, &reg.a, fill_state);
+		}
+		RANDOMX_PROFILE_SCOPE(this, ProfileBlake2b);
 		blake2b(out, outSize, &reg, sizeof(RegisterFile), nullptr, 0);
 	}
 
 	template<class Allocator, bool softAes>
 	void VmBase<Allocator, softAes>::initScratchpad(void* seed) {
-		fillAes1Rx4<softAes>(seed, ScratchpadSize, scratchpad);
+		RANDOMX_PROFILE_SCOPE(this, ProfileFillScratchpad);
+		if (softAes && bitsliceAes)
+			fillAes1Rx4Bitsliced(seed, ScratchpadSize, scratchpad);
+		else
+			fillAes1Rx4<softAes>(seed, ScratchpadSize, scratchpad);
 	}
 
 	template<class Allocator, bool softAes>
 	void VmBase<Allocator, softAes>::generateProgram(void* seed) {
-		fillAes4Rx4<softAes>(seed, sizeof(program), &program);
+		RANDOMX_PROFILE_SCOPE(this, ProfileGenerateProgram);
+		if (softAes && bitsliceAes)
+			fillAes4Rx4Bitsliced(seed, sizeof(program), &program);
+		else
+			fillAes4Rx4<softAes>(seed, sizeof(program), &program);
 	}
 
 	template class VmBase<AlignedAllocator<CacheLineSize>, false>;
 	template class VmBase<AlignedAllocator<CacheLineSize>, true>;
 	template class VmBase<LargePageAllocator, false>;
 	template class VmBase<LargePageAllocator, true>;
+	template class VmBase<ScratchpadArenaAllocator, false>;
+	template class VmBase<ScratchpadArenaAllocator, true>;
 }
\ No newline at end of file
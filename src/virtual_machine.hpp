@@ -31,6 +31,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdint>
 #include "common.hpp"
 #include "program.hpp"
+#include "profile.hpp"
+
+namespace randomx {
+	class PerfCounters;
+}
 
 /* Global namespace for C binding */
 class randomx_vm {
@@ -46,6 +51,20 @@ public:
 
 	virtual void setExperimental(bool exp) {};
 
+	//number of instruction dispatches saved by fused bytecode handlers (interpreter only)
+	virtual uint64_t getDispatchesSaved() { return 0; }
+
+	virtual bool hasHardwareAes() const { return false; }
+
+	//use the constant-time bitsliced software AES (software AES VMs only)
+	void setBitsliceAes(bool bitslice) {
+		bitsliceAes = bitslice;
+	}
+
+	virtual void setPrefetchMode(randomx_prefetch_mode mode) {
+		prefetchMode = mode;
+	}
+
 	void resetRoundingMode();
 	randomx::RegisterFile *getRegisterFile() {
 		return &reg;
@@ -69,9 +88,16 @@ protected:
 		randomx_dataset* datasetPtr;
 	};
 	uint64_t datasetOffset;
+	bool bitsliceAes = false;
+	randomx_prefetch_mode prefetchMode = RANDOMX_PREFETCH_NTA;
+	void prefetchDataset(uint8_t* address);
 public:
 	std::string cacheKey;
 	alignas(16) uint64_t tempHash[8]; //8 64-bit values used to store intermediate data
+	randomx::PerfCounters* perf = nullptr;
+#ifdef RANDOMX_PROFILE
+	randomx::ProfileCounters profile = {};
+#endif
 };
 
 namespace randomx {
@@ -84,6 +110,7 @@ namespace randomx {
 		void initScratchpad(void* seed) override;
 		void getFinalResult(void* out, size_t outSize) override;
 		void hashAndFill(void* out, size_t outSize, uint64_t *fill_state) override;
+		bool hasHardwareAes() const override { return !softAes; }
 	protected:
 		void generateProgram(void* seed);
 	};
@@ -27,9 +27,15 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "virtual_memory.hpp"
+#include "randomx.h"
 
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
 
 #if defined(_WIN32) || defined(__CYGWIN__)
 #include <windows.h>
@@ -44,6 +50,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS MAP_ANON
 #endif
@@ -167,7 +177,44 @@ void setPagesRWX(void* ptr, std::size_t bytes) {
 	pageProtect(ptr, bytes, PAGE_EXECUTE_READWRITE);
 }
 
-void* allocLargePagesMemory(std::size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+constexpr std::size_t TransparentHugePageSize = 2 * 1024 * 1024;
+
+static bool transparentHugePagesEnabled() {
+	static const bool enabled = [] {
+		std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+		std::string mode;
+		return std::getline(file, mode) && mode.find("[never]") == std::string::npos;
+	}();
+	return enabled;
+}
+
+//anonymous mapping aligned to the huge page size and marked with MADV_HUGEPAGE,
+//used when no hugetlbfs pages are reserved
+static void* allocTransparentHugePages(std::size_t bytes, bool populate) {
+	const std::size_t mapSize = bytes + TransparentHugePageSize;
+	uint8_t* raw = (uint8_t*)mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED)
+		return MAP_FAILED;
+	uint8_t* mem = (uint8_t*)alignSize((uintptr_t)raw, TransparentHugePageSize);
+	uint8_t* end = (uint8_t*)alignSize((uintptr_t)mem + bytes, 4096);
+	if (mem != raw)
+		munmap(raw, mem - raw);
+	if (end != raw + mapSize)
+		munmap(end, raw + mapSize - end);
+	if (madvise(mem, bytes, MADV_HUGEPAGE) != 0) {
+		munmap(mem, bytes);
+		return MAP_FAILED;
+	}
+#ifdef MADV_POPULATE_WRITE
+	if (populate)
+		madvise(mem, bytes, MADV_POPULATE_WRITE);
+#endif
+	return mem;
+}
+#endif
+
+void* allocLargePagesMemory(std::size_t bytes, bool populate) {
 	void* mem;
 #if defined(_WIN32) || defined(__CYGWIN__)
 	setPrivilege("SeLockMemoryPrivilege", 1);
@@ -187,16 +234,21 @@ void* allocLargePagesMemory(std::size_t bytes) {
 	mem = MAP_FAILED; // OpenBSD does not support huge pages
 #else
 #define MAP_HUGE_1GB    (30 << MAP_HUGE_SHIFT)
+    //without MAP_POPULATE, pages are faulted in by the first thread that writes them
+    const int populateFlag = populate ? MAP_POPULATE : 0;
     if (bytes >= 1073741824) {
-      mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB | MAP_POPULATE, -1, 0);
+      mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB | populateFlag, -1, 0);
     } else {
       mem = MAP_FAILED;
     }
     if (mem == MAP_FAILED) {
-      mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
-    } else {
-      std::cout << "# Good news, was able to use 1gb hugepages!" << std::endl;
+      mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populateFlag, -1, 0);
+    }
+#ifdef MADV_HUGEPAGE
+    if (mem == MAP_FAILED && transparentHugePagesEnabled()) {
+      mem = allocTransparentHugePages(bytes, populate);
     }
+#endif
 #endif
 	if (mem == MAP_FAILED) {
       //std::cout << "# Failed to allocate hugepages: " << bytes << std::endl;
@@ -207,6 +259,17 @@ void* allocLargePagesMemory(std::size_t bytes) {
 	return mem;
 }
 
+void* allocGigaPagesMemory(std::size_t bytes) {
+#if defined(__linux__) && defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+	void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB | MAP_POPULATE, -1, 0);
+	if (mem == MAP_FAILED)
+		throw std::runtime_error("allocGigaPagesMemory - mmap failed");
+	return mem;
+#else
+	throw std::runtime_error("allocGigaPagesMemory - 1 GiB pages are not supported");
+#endif
+}
+
 void freePagedMemory(void* ptr, std::size_t bytes) {
 #if defined(_WIN32) || defined(__CYGWIN__)
 	VirtualFree(ptr, 0, MEM_RELEASE);
@@ -214,3 +277,201 @@ void freePagedMemory(void* ptr, std::size_t bytes) {
 	munmap(ptr, bytes);
 #endif
 }
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+//named objects are created in hugetlbfs (huge pages) or as POSIX shared memory
+static const char HugetlbfsMount[] = "/dev/hugepages";
+
+static std::string sharedObjectName(const char* name) {
+	std::string objectName(name != nullptr ? name : "");
+	if (objectName.empty() || objectName.size() > 200 || objectName.find('/') != std::string::npos)
+		throw std::runtime_error("mapSharedMemory - invalid name");
+	return "/randomx-" + objectName;
+}
+
+//the creation lock is a separate object that does not clash with any object name
+static std::string sharedLockName(const std::string& objectName) {
+	return "/." + objectName.substr(1);
+}
+
+//a zero-sized object was just created by this or another process and is sized here;
+//a different size means a different RandomX configuration. fd is closed if mapping fails.
+static void* mapSharedFile(int& fd, std::size_t bytes) {
+	struct stat st;
+	void* mem = MAP_FAILED;
+	if (fd >= 0) {
+		if (fstat(fd, &st) == 0 && (st.st_size == 0 ? ftruncate(fd, bytes) == 0 : (std::size_t)st.st_size == bytes))
+			mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mem == MAP_FAILED) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	return mem;
+}
+#endif
+
+void* mapSharedMemory(const char* name, std::size_t bytes, bool largePages, int* lockFd) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+	throw std::runtime_error("mapSharedMemory - shared memory datasets are not supported");
+#else
+	const std::string objectName = sharedObjectName(name);
+	const std::string hugetlbfsPath = HugetlbfsMount + objectName;
+	//processes attach or create one at a time, otherwise two of them could create
+	//the hugetlbfs object and the POSIX shared memory object at the same time
+	int creationFd = shm_open(sharedLockName(objectName).c_str(), O_RDWR | O_CREAT, 0600);
+	if (creationFd < 0)
+		throw std::runtime_error("mapSharedMemory - cannot open the lock of " + objectName);
+	try {
+		lockSharedMemory(creationFd, 0, true);
+	}
+	catch (...) {
+		close(creationFd);
+		throw;
+	}
+	int fd;
+	void* mem = MAP_FAILED;
+	bool exists = false;
+	//attach to an existing object first, so all processes use the same one regardless of their flags
+	for (int attempt = 0; attempt < 2 && mem == MAP_FAILED; ++attempt) {
+		fd = open(hugetlbfsPath.c_str(), O_RDWR);
+		mem = mapSharedFile(fd, bytes);
+		if (mem == MAP_FAILED) {
+			fd = shm_open(objectName.c_str(), O_RDWR, 0);
+			mem = mapSharedFile(fd, bytes);
+		}
+		if (mem == MAP_FAILED && largePages && !exists) {
+			fd = open(hugetlbfsPath.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+			bool created = fd >= 0;
+			//created by a process that does not use the creation lock, attach to it
+			exists = !created && errno == EEXIST;
+			mem = mapSharedFile(fd, bytes);
+			if (created && mem == MAP_FAILED)
+				unlink(hugetlbfsPath.c_str()); //not enough huge pages reserved
+		}
+	}
+	if (mem == MAP_FAILED && !exists) {
+		fd = shm_open(objectName.c_str(), O_RDWR | O_CREAT, 0600);
+		mem = mapSharedFile(fd, bytes);
+	}
+	close(creationFd);
+	if (mem == MAP_FAILED)
+		throw std::runtime_error("mapSharedMemory - cannot map " + objectName);
+	*lockFd = fd;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	//shmem uses transparent huge pages if /sys/kernel/mm/transparent_hugepage/shmem_enabled allows it
+	if (largePages)
+		madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+	return mem;
+#endif
+}
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+//Each lock is one byte of the object. Open file description locks belong to the descriptor,
+//so separate mappings in one process exclude each other; classic record locks are per process.
+//Both are released by the kernel when the holding process exits, regardless of PID namespaces.
+static int setSharedMemoryLock(int fd, unsigned lock, short type, bool wait) {
+	struct flock fl;
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = type;
+	fl.l_whence = SEEK_SET;
+	fl.l_start = lock;
+	fl.l_len = 1;
+#ifdef F_OFD_SETLKW
+	return fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl);
+#else
+	return fcntl(fd, wait ? F_SETLKW : F_SETLK, &fl);
+#endif
+}
+#endif
+
+void lockSharedMemory(int fd, unsigned lock, bool exclusive) {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	while (setSharedMemoryLock(fd, lock, exclusive ? F_WRLCK : F_RDLCK, true) != 0) {
+		if (errno != EINTR)
+			throw std::runtime_error("lockSharedMemory - fcntl failed");
+	}
+#endif
+}
+
+bool tryLockSharedMemory(int fd, unsigned lock, bool exclusive) {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	while (setSharedMemoryLock(fd, lock, exclusive ? F_WRLCK : F_RDLCK, false) != 0) {
+		if (errno == EAGAIN || errno == EACCES)
+			return false;
+		if (errno != EINTR)
+			throw std::runtime_error("tryLockSharedMemory - fcntl failed");
+	}
+#endif
+	return true;
+}
+
+void unlockSharedMemory(int fd, unsigned lock) {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	setSharedMemoryLock(fd, lock, F_UNLCK, false);
+#endif
+}
+
+void closeSharedMemoryLock(int fd) {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+bool unlinkSharedMemory(const char* name) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+	return false;
+#else
+	const std::string objectName = sharedObjectName(name);
+	bool removed = unlink((HugetlbfsMount + objectName).c_str()) == 0;
+	removed |= shm_unlink(objectName.c_str()) == 0;
+	shm_unlink(sharedLockName(objectName).c_str());
+	return removed;
+#endif
+}
+
+bool getPageInfo(const void* ptr, std::size_t bytes, randomx_page_info* info) {
+	memset(info, 0, sizeof(randomx_page_info));
+	info->size = bytes;
+#if defined(__linux__)
+	std::ifstream smaps("/proc/self/smaps");
+	if (!smaps)
+		return false;
+	const uintptr_t begin = (uintptr_t)ptr;
+	const uintptr_t end = begin + bytes;
+	uintptr_t vmaBegin = 0, vmaEnd = 0;
+	double share = 0;
+	std::string line;
+	while (std::getline(smaps, line)) {
+		unsigned long a, b, kb;
+		char field[64];
+		if (sscanf(line.c_str(), "%lx-%lx ", &a, &b) == 2) {
+			vmaBegin = a;
+			vmaEnd = b;
+			uintptr_t overlapBegin = vmaBegin > begin ? vmaBegin : begin;
+			uintptr_t overlapEnd = vmaEnd < end ? vmaEnd : end;
+			//counters are per mapping, so a mapping that is shared with other data is counted proportionally
+			share = overlapEnd > overlapBegin ? (double)(overlapEnd - overlapBegin) / (vmaEnd - vmaBegin) : 0;
+			continue;
+		}
+		if (share == 0 || sscanf(line.c_str(), "%63[^:]: %lu kB", field, &kb) != 2)
+			continue;
+		std::size_t value = (std::size_t)(share * kb * 1024);
+		if (strcmp(field, "KernelPageSize") == 0 && (std::size_t)kb * 1024 > info->page_size)
+			info->page_size = (std::size_t)kb * 1024;
+		else if (strcmp(field, "Rss") == 0)
+			info->resident_bytes += value;
+		else if (strcmp(field, "AnonHugePages") == 0 || strcmp(field, "ShmemPmdMapped") == 0 || strcmp(field, "FilePmdMapped") == 0)
+			info->thp_bytes += value;
+		else if (strcmp(field, "Private_Hugetlb") == 0 || strcmp(field, "Shared_Hugetlb") == 0) {
+			info->hugetlb_bytes += value;
+			info->resident_bytes += value; //not included in Rss
+		}
+	}
+	return info->page_size != 0;
+#else
+	return false;
+#endif
+}
@@ -30,6 +30,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstddef>
 
+struct randomx_page_info;
+
 constexpr std::size_t alignSize(std::size_t pos, std::size_t align) {
 	return ((pos - 1) / align + 1) * align;
 }
@@ -38,5 +40,15 @@ void* allocMemoryPages(std::size_t);
 void setPagesRW(void*, std::size_t);
 void setPagesRX(void*, std::size_t);
 void setPagesRWX(void*, std::size_t);
-void* allocLargePagesMemory(std::size_t);
+void* allocLargePagesMemory(std::size_t, bool populate = true);
+void* allocGigaPagesMemory(std::size_t);
 void freePagedMemory(void*, std::size_t);
+//lockFd receives a descriptor of the mapped object for lockSharedMemory,
+//it must be closed with closeSharedMemoryLock
+void* mapSharedMemory(const char* name, std::size_t, bool largePages, int* lockFd);
+void lockSharedMemory(int fd, unsigned lock, bool exclusive);
+bool tryLockSharedMemory(int fd, unsigned lock, bool exclusive);
+void unlockSharedMemory(int fd, unsigned lock);
+void closeSharedMemoryLock(int fd);
+bool unlinkSharedMemory(const char* name);
+bool getPageInfo(const void*, std::size_t, randomx_page_info*);
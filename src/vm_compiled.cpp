@@ -52,19 +52,23 @@ namespace randomx {
 		VmBase<Allocator, softAes>::generateProgram(seed);
 		randomx_vm::initialize();
 		mem.memory = datasetPtr->memory + datasetOffset;
-		rx_prefetch_nta(mem.memory + mem.ma);
-		if (secureJit) {
-			compiler.enableWriting();
-		}
-		compiler.generateProgram(program, config);
-		if (secureJit) {
-			compiler.enableExecution();
+		this->prefetchDataset(mem.memory + mem.ma);
+		{
+			RANDOMX_PROFILE_SCOPE(this, ProfileCompile);
+			if (secureJit) {
+				compiler.enableWriting();
+			}
+			compiler.generateProgram(program, config);
+			if (secureJit) {
+				compiler.enableExecution();
+			}
 		}
 		execute();
 	}
 
 	template<class Allocator, bool softAes, bool secureJit>
 	void CompiledVm<Allocator, softAes, secureJit>::execute() {
+		RANDOMX_PROFILE_SCOPE(this, ProfileExecute);
 #ifdef __aarch64__
 		memcpy(reg.f, config.eMask, sizeof(config.eMask));
 #endif
@@ -79,4 +83,8 @@ namespace randomx {
 	template class CompiledVm<AlignedAllocator<CacheLineSize>, true, true>;
 	template class CompiledVm<LargePageAllocator, false, true>;
 	template class CompiledVm<LargePageAllocator, true, true>;
+	template class CompiledVm<ScratchpadArenaAllocator, false, false>;
+	template class CompiledVm<ScratchpadArenaAllocator, true, false>;
+	template class CompiledVm<ScratchpadArenaAllocator, false, true>;
+	template class CompiledVm<ScratchpadArenaAllocator, true, true>;
 }
@@ -52,6 +52,10 @@ namespace randomx {
 		CompiledVm();
 		void setDataset(randomx_dataset* dataset) override;
 		void run(void* seed) override;
+		void setPrefetchMode(randomx_prefetch_mode mode) override {
+			randomx_vm::setPrefetchMode(mode);
+			compiler.setPrefetchMode(mode);
+		}
 		void setExperimental(bool exp) override {
 #ifdef ENABLE_EXPERIMENTAL
 			compiler.experimental = exp;
@@ -79,4 +83,8 @@ namespace randomx {
 	using CompiledVmHardAesSecure = CompiledVm<AlignedAllocator<CacheLineSize>, false, true>;
 	using CompiledVmLargePageSecure = CompiledVm<LargePageAllocator, true, true>;
 	using CompiledVmLargePageHardAesSecure = CompiledVm<LargePageAllocator, false, true>;
+	using CompiledVmArena = CompiledVm<ScratchpadArenaAllocator, true, false>;
+	using CompiledVmArenaHardAes = CompiledVm<ScratchpadArenaAllocator, false, false>;
+	using CompiledVmArenaSecure = CompiledVm<ScratchpadArenaAllocator, true, true>;
+	using CompiledVmArenaHardAesSecure = CompiledVm<ScratchpadArenaAllocator, false, true>;
 }
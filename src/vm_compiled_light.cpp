@@ -28,6 +28,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "vm_compiled_light.hpp"
 #include "common.hpp"
+#include "dataset.hpp"
 #include <stdexcept>
 
 namespace randomx {
@@ -45,16 +46,24 @@ namespace randomx {
 		}
 	}
 
+	template<class Allocator, bool softAes, bool secureJit>
+	void CompiledLightVm<Allocator, softAes, secureJit>::setDataset(randomx_dataset* dataset) {
+		compiler.setDatasetPrefix(dataset->memory, dataset->itemCount);
+	}
+
 	template<class Allocator, bool softAes, bool secureJit>
 	void CompiledLightVm<Allocator, softAes, secureJit>::run(void* seed) {
 		VmBase<Allocator, softAes>::generateProgram(seed);
 		randomx_vm::initialize();
-		if (secureJit) {
-			compiler.enableWriting();
-		}
-		compiler.generateProgramLight(program, config, datasetOffset);
-		if (secureJit) {
-			compiler.enableExecution();
+		{
+			RANDOMX_PROFILE_SCOPE(this, ProfileCompile);
+			if (secureJit) {
+				compiler.enableWriting();
+			}
+			compiler.generateProgramLight(program, config, datasetOffset);
+			if (secureJit) {
+				compiler.enableExecution();
+			}
 		}
 		CompiledVm<Allocator, softAes, secureJit>::execute();
 	}
@@ -67,4 +76,8 @@ namespace randomx {
 	template class CompiledLightVm<AlignedAllocator<CacheLineSize>, true, true>;
 	template class CompiledLightVm<LargePageAllocator, false, true>;
 	template class CompiledLightVm<LargePageAllocator, true, true>;
+	template class CompiledLightVm<ScratchpadArenaAllocator, false, false>;
+	template class CompiledLightVm<ScratchpadArenaAllocator, true, false>;
+	template class CompiledLightVm<ScratchpadArenaAllocator, false, true>;
+	template class CompiledLightVm<ScratchpadArenaAllocator, true, true>;
 }
\ No newline at end of file
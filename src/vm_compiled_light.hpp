@@ -46,7 +46,7 @@ namespace randomx {
 			AlignedAllocator<CacheLineSize>::freeMemory(ptr, sizeof(CompiledLightVm));
 		}
 		void setCache(randomx_cache* cache) override;
-		void setDataset(randomx_dataset* dataset) override { }
+		void setDataset(randomx_dataset* dataset) override;
 		void run(void* seed) override;
 
 		using CompiledVm<Allocator, softAes, secureJit>::mem;
@@ -65,4 +65,8 @@ namespace randomx {
 	using CompiledLightVmHardAesSecure = CompiledLightVm<AlignedAllocator<CacheLineSize>, false, true>;
 	using CompiledLightVmLargePageSecure = CompiledLightVm<LargePageAllocator, true, true>;
 	using CompiledLightVmLargePageHardAesSecure = CompiledLightVm<LargePageAllocator, false, true>;
+	using CompiledLightVmArena = CompiledLightVm<ScratchpadArenaAllocator, true, false>;
+	using CompiledLightVmArenaHardAes = CompiledLightVm<ScratchpadArenaAllocator, false, false>;
+	using CompiledLightVmArenaSecure = CompiledLightVm<ScratchpadArenaAllocator, true, true>;
+	using CompiledLightVmArenaHardAesSecure = CompiledLightVm<ScratchpadArenaAllocator, false, true>;
 }
\ No newline at end of file
@@ -60,7 +60,11 @@ namespace randomx {
 		for(unsigned i = 0; i < RegisterCountFlt; ++i)
 			nreg.a[i] = rx_load_vec_f128(&reg.a[i].lo);
 
-		compileProgram(program, bytecode, nreg);
+		{
+			RANDOMX_PROFILE_SCOPE(this, ProfileCompile);
+			compileProgram(program, bytecode, nreg);
+		}
+		RANDOMX_PROFILE_SCOPE(this, ProfileExecute);
 
 		uint32_t spAddr0 = mem.mx;
 		uint32_t spAddr1 = mem.ma;
@@ -81,7 +85,11 @@ namespace randomx {
 			for (unsigned i = 0; i < RegisterCountFlt; ++i)
 				nreg.e[i] = maskRegisterExponentMantissa(config, rx_cvt_packed_int_vec_f128(scratchpad + spAddr1 + 8 * (RegisterCountFlt + i)));
 
+#ifdef RANDOMX_THREADED_INTERPRETER
+			dispatchesSaved += executeBytecodeThreaded(bytecode, scratchpad, config);
+#else
 			executeBytecode(bytecode, scratchpad, config);
+#endif
 
 			mem.mx ^= nreg.r[config.readReg2] ^ nreg.r[config.readReg3];
 			mem.mx &= CacheLineAlignMask;
@@ -121,7 +129,7 @@ namespace randomx {
 
 	template<class Allocator, bool softAes>
 	void InterpretedVm<Allocator, softAes>::datasetPrefetch(uint64_t address) {
-		rx_prefetch_nta(mem.memory + address);
+		this->prefetchDataset(mem.memory + address);
 	}
 
 	template class InterpretedVm<AlignedAllocator<CacheLineSize>, false>;
@@ -59,13 +59,17 @@ namespace randomx {
 		}
 		void run(void* seed) override;
 		void setDataset(randomx_dataset* dataset) override;
+		uint64_t getDispatchesSaved() override {
+			return dispatchesSaved;
+		}
 	protected:
 		virtual void datasetRead(uint64_t blockNumber, int_reg_t(&r)[RegistersCount]);
 		virtual void datasetPrefetch(uint64_t blockNumber);
 	private:
 		void execute();
 
-		InstructionByteCode bytecode[RANDOMX_PROGRAM_SIZE];
+		InstructionByteCode bytecode[BytecodeSize];
+		uint64_t dispatchesSaved = 0;
 	};
 
 	using InterpretedVmDefault = InterpretedVm<AlignedAllocator<CacheLineSize>, true>;
@@ -28,6 +28,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "vm_interpreted_light.hpp"
 #include "dataset.hpp"
+#include <cstring>
 
 namespace randomx {
 
@@ -37,12 +38,21 @@ namespace randomx {
 		mem.memory = cache->memory;
 	}
 
+	template<class Allocator, bool softAes>
+	void InterpretedLightVm<Allocator, softAes>::setDataset(randomx_dataset* dataset) {
+		prefixMemory = dataset->memory;
+		prefixItems = dataset->itemCount;
+	}
+
 	template<class Allocator, bool softAes>
 	void InterpretedLightVm<Allocator, softAes>::datasetRead(uint64_t address, int_reg_t(&r)[8]) {
 		uint32_t itemNumber = address / CacheLineSize;
 		int_reg_t rl[8];
-		
-		initDatasetItem(cachePtr, (uint8_t*)rl, itemNumber);
+
+		if (itemNumber < prefixItems)
+			memcpy(rl, prefixMemory + address, CacheLineSize);
+		else
+			initDatasetItem(cachePtr, (uint8_t*)rl, itemNumber);
 
 		for (unsigned q = 0; q < 8; ++q)
 			r[q] ^= rl[q];
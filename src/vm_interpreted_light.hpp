@@ -47,11 +47,14 @@ namespace randomx {
 		void operator delete(void* ptr) {
 			AlignedAllocator<CacheLineSize>::freeMemory(ptr, sizeof(InterpretedLightVm));
 		}
-		void setDataset(randomx_dataset* dataset) override { }
+		void setDataset(randomx_dataset* dataset) override;
 		void setCache(randomx_cache* cache) override;
 	protected:
 		void datasetRead(uint64_t address, int_reg_t(&r)[8]) override;
 		void datasetPrefetch(uint64_t address) override { }
+		//precomputed items of a partial dataset
+		const uint8_t* prefixMemory = nullptr;
+		uint32_t prefixItems = 0;
 	};
 
 	using InterpretedLightVmDefault = InterpretedLightVm<AlignedAllocator<CacheLineSize>, true>;